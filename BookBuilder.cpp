@@ -0,0 +1,293 @@
+// Offline opening book builder, built from the same engine sources as the bot:
+//   g++ -std=c++17 -O2 -pthread BookBuilder.cpp -o BookBuilder
+//   ./BookBuilder -d 4 -w 3 -p 200000 -o data/hexbook.bin
+// Searched positions are appended to <out>.journal as they finish, rerunning the same
+// command after an interruption resumes from the journal.
+#define HEXMCTS_NO_MAIN
+#include "HexMctsBranching.cpp"
+
+#include <map>
+#include <cstdio>
+
+/**
+ * @brief A position to search, stored as the moves leading to it
+ *
+ */
+struct BookPosition
+{
+    std::vector<action2D> moves;
+    GameState state;
+};
+
+/**
+ * @brief Breadth first opening book builder, searches positions of one depth on every core
+ *
+ */
+class BookBuilder
+{
+private:
+    int _depth;
+    int _width;
+    int _playouts;
+    int _threads;
+    std::string _outPath;
+    std::string _journalPath;
+    // records of searched positions, from the journal and from this run
+    std::map<uint64_t, std::vector<BookRecord>> _searched;
+    std::mutex _mutex;
+    FILE *_journal;
+
+    /**
+     * @brief load records of an interrupted run, ignores a truncated last record
+     *
+     */
+    void loadJournal();
+
+    /**
+     * @brief search one position and stream its records to the journal
+     *
+     * @param position
+     */
+    void searchPosition(BookPosition &position);
+
+    /**
+     * @brief search every position of a level in parallel
+     *
+     * @param level
+     */
+    void searchLevel(std::vector<BookPosition> &level);
+
+    /**
+     * @brief sort all records and write the mmap-able book
+     *
+     * @return true
+     * @return false
+     */
+    bool writeBook();
+
+public:
+    /**
+     * @brief Construct a new Book Builder object
+     *
+     * @param depth plies to expand from the empty board
+     * @param width book moves kept and expanded per position
+     * @param playouts playouts of each position search
+     * @param threads worker threads
+     * @param outPath path of the book file
+     */
+    BookBuilder(int depth, int width, int playouts, int threads, std::string outPath);
+
+    /**
+     * @brief build the book, resuming from the journal if one exists
+     *
+     * @return int exit code
+     */
+    int run();
+};
+
+BookBuilder::BookBuilder(int depth, int width, int playouts, int threads, std::string outPath)
+    : _depth(depth), _width(width), _playouts(playouts), _threads(threads), _outPath(outPath), _journalPath(outPath + ".journal"), _searched(), _mutex(), _journal(nullptr) {}
+
+void BookBuilder::loadJournal()
+{
+    FILE *journal = fopen(_journalPath.c_str(), "rb");
+    if (journal == nullptr)
+    {
+        return;
+    }
+    BookRecord record;
+    int count = 0;
+    while (fread(&record, sizeof(BookRecord), 1, journal) == 1)
+    {
+        _searched[record.key].push_back(record);
+        count++;
+    }
+    fclose(journal);
+    // drop a record cut by the interruption so appended records stay aligned
+    if (truncate(_journalPath.c_str(), (off_t)count * sizeof(BookRecord)) != 0)
+    {
+        printf("Cannot truncate journal %s\n", _journalPath.c_str());
+    }
+    printf("Resumed %d records of %zu positions from %s\n", count, _searched.size(), _journalPath.c_str());
+}
+
+void BookBuilder::searchPosition(BookPosition &position)
+{
+    // each worker owns its tree, the solver stays off so all cores go to playouts
+    MCTS mcts(MCTS::EXPLORATION, 1000, BOARD_CELLS + 1);
+    mcts.setState(position.state);
+    mcts.search(_playouts);
+
+    std::vector<std::pair<action2D, MCTSNode *>> children;
+    for (auto &child : *mcts.getRoot()->getChildren())
+    {
+        children.push_back({child.first, child.second.get()});
+    }
+    std::sort(children.begin(), children.end(), [](const std::pair<action2D, MCTSNode *> &a, const std::pair<action2D, MCTSNode *> &b)
+              { return a.second->getVisits() > b.second->getVisits(); });
+    if ((int)children.size() > _width)
+    {
+        children.resize(_width);
+    }
+
+    std::vector<BookRecord> records;
+    for (auto &child : children)
+    {
+        // stored in canonical orientation, so both rotations of a position share records
+        action2D action = position.state.canonicalIsRotated() ? GameState::rotate(child.first) : child.first;
+        BookRecord record = {};
+        record.key = position.state.getCanonicalKey();
+        record.visits = child.second->getVisits();
+        record.value = child.second->getQuality();
+        record.actionX = action.actionX;
+        record.actionY = action.actionY;
+        records.push_back(record);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // one write per position, flushed so an interruption loses at most the running searches
+    fwrite(records.data(), sizeof(BookRecord), records.size(), _journal);
+    fflush(_journal);
+    _searched[position.state.getCanonicalKey()] = records;
+}
+
+void BookBuilder::searchLevel(std::vector<BookPosition> &level)
+{
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> done(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < _threads; t++)
+    {
+        workers.push_back(std::thread([&]()
+                                      {
+                                          for (size_t i = next++; i < level.size(); i = next++)
+                                          {
+                                              searchPosition(level[i]);
+                                              size_t finished = ++done;
+                                              std::lock_guard<std::mutex> lock(_mutex);
+                                              printf("  %zu/%zu positions\n", finished, level.size());
+                                          } }));
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+bool BookBuilder::writeBook()
+{
+    std::vector<BookRecord> records;
+    for (auto &entry : _searched)
+    {
+        records.insert(records.end(), entry.second.begin(), entry.second.end());
+    }
+    std::sort(records.begin(), records.end(), [](const BookRecord &a, const BookRecord &b)
+              { return a.key < b.key || (a.key == b.key && a.visits > b.visits); });
+
+    BookHeader header = {};
+    memcpy(header.magic, BOOK_MAGIC, 8);
+    header.version = BOOK_VERSION;
+    header.count = records.size();
+    // write aside and rename, a reader never maps a half written book
+    std::string tmpPath = _outPath + ".tmp";
+    FILE *out = fopen(tmpPath.c_str(), "wb");
+    if (out == nullptr)
+    {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(BookHeader), 1, out) == 1 &&
+              fwrite(records.data(), sizeof(BookRecord), records.size(), out) == records.size();
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), _outPath.c_str()) != 0)
+    {
+        return false;
+    }
+    printf("Wrote %zu records of %zu positions to %s\n", records.size(), _searched.size(), _outPath.c_str());
+    return true;
+}
+
+int BookBuilder::run()
+{
+    loadJournal();
+    _journal = fopen(_journalPath.c_str(), "ab");
+    if (_journal == nullptr)
+    {
+        printf("Cannot open journal %s\n", _journalPath.c_str());
+        return 1;
+    }
+
+    std::vector<BookPosition> level = {BookPosition{{}, GameState()}};
+    for (int depth = 0; depth < _depth && level.size() > 0; depth++)
+    {
+        std::vector<BookPosition> pending;
+        for (auto &position : level)
+        {
+            if (_searched.find(position.state.getCanonicalKey()) == _searched.end())
+            {
+                pending.push_back(position);
+            }
+        }
+        printf("Depth %d: %zu positions, %zu to search\n", depth, level.size(), pending.size());
+        searchLevel(pending);
+
+        // next level from the book moves of this one, transpositions and rotations are expanded once
+        std::vector<BookPosition> nextLevel;
+        std::unordered_map<uint64_t, bool> seen;
+        for (auto &position : level)
+        {
+            for (auto &record : _searched[position.state.getCanonicalKey()])
+            {
+                BookPosition child = position;
+                action2D action = {record.actionX, record.actionY};
+                if (position.state.canonicalIsRotated())
+                {
+                    action = GameState::rotate(action);
+                }
+                child.moves.push_back(action);
+                child.state.plays(action);
+                if (!seen[child.state.getCanonicalKey()])
+                {
+                    seen[child.state.getCanonicalKey()] = true;
+                    nextLevel.push_back(child);
+                }
+            }
+        }
+        level = nextLevel;
+    }
+    fclose(_journal);
+    return writeBook() ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    int depth = 4, width = 3, playouts = 200000;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string outPath = "data/hexbook.bin";
+    int opt;
+    while ((opt = getopt(argc, argv, "d:w:p:t:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'p':
+            playouts = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            printf("Usage: %s [-d depth] [-w width] [-p playouts] [-t threads] [-o book]\n", argv[0]);
+            return 1;
+        }
+    }
+    BookBuilder builder(depth, width, playouts, threads, outPath);
+    return builder.run();
+}
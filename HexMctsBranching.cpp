@@ -1,7 +1,7 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <sys/time.h>
+#include <time.h>
 #include <stdio.h>
 #include <vector>
 #include <unordered_map>
@@ -9,8 +9,40 @@
 #include <memory>
 #include <cstdlib>
 #include <cmath>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <type_traits>
+#include <limits>
 #include "jsoncpp/json.h"
 
+// board side, -DHEX_BOARD_SIZE=N builds the engine for another size, the judge plays 11
+#ifndef HEX_BOARD_SIZE
+#define HEX_BOARD_SIZE 11
+#endif
+constexpr int BOARD_SIZE = HEX_BOARD_SIZE;
+constexpr int BOARD_LAST = BOARD_SIZE - 1;
+constexpr int BOARD_CELLS = BOARD_SIZE * BOARD_SIZE;
+// 64 bit words of a Bitboard
+constexpr int BOARD_WORDS = (BOARD_CELLS + 63) / 64;
+// bits of the last word that are cells
+constexpr uint64_t LAST_WORD_MASK = BOARD_CELLS % 64 == 0 ? ~0ULL : (1ULL << (BOARD_CELLS % 64)) - 1;
+static_assert(BOARD_SIZE >= 9 && BOARD_SIZE <= 19, "board sizes from 9 to 19 are supported");
+// cell indices and move histories, one byte while every index and NO_MOVE fit
+typedef std::conditional<BOARD_CELLS < 255, unsigned char, unsigned short>::type cell_t;
+
 // Class Headers
 
 /**
@@ -48,6 +80,243 @@ struct ActionPrior
     float probability;
 };
 
+/**
+ * @brief index of a board cell, actionX * BOARD_SIZE + actionY
+ *
+ */
+struct CellIndex
+{
+    cell_t value;
+
+    constexpr action2D action() const
+    {
+        return {value / BOARD_SIZE, value % BOARD_SIZE};
+    }
+};
+
+struct CellPrior
+{
+    CellIndex cell;
+    float probability;
+};
+
+/**
+ * @brief vector of at most CAPACITY items stored in place, for buffers filled in the hot
+ * paths without allocating
+ *
+ */
+template <typename T, int CAPACITY>
+class FixedBuffer
+{
+private:
+    T _items[CAPACITY];
+    int _size = 0;
+
+public:
+    void push_back(const T &item)
+    {
+        _items[_size++] = item;
+    }
+
+    void clear()
+    {
+        _size = 0;
+    }
+
+    // keeps the first size items, items past the old size are left as they were
+    void resize(int size)
+    {
+        _size = size;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    T &operator[](int i)
+    {
+        return _items[i];
+    }
+
+    const T &operator[](int i) const
+    {
+        return _items[i];
+    }
+
+    T *begin()
+    {
+        return _items;
+    }
+
+    T *end()
+    {
+        return _items + _size;
+    }
+
+    const T *begin() const
+    {
+        return _items;
+    }
+
+    const T *end() const
+    {
+        return _items + _size;
+    }
+};
+
+// one entry per cell at most
+typedef FixedBuffer<CellPrior, BOARD_CELLS> MoveBuffer;
+typedef FixedBuffer<CellIndex, BOARD_CELLS> CellBuffer;
+
+/**
+ * @brief Set of board cells, bit actionX * BOARD_SIZE + actionY, cells 0-63 in the first word
+ *
+ */
+struct Bitboard
+{
+    uint64_t w[BOARD_WORDS];
+
+    static constexpr Bitboard single(int idx)
+    {
+        Bitboard b = {{0, 0}};
+        b.w[idx >> 6] = 1ULL << (idx & 63);
+        return b;
+    }
+
+    constexpr bool test(int idx) const
+    {
+        return (w[idx >> 6] >> (idx & 63)) & 1;
+    }
+
+    constexpr void set(int idx)
+    {
+        w[idx >> 6] |= 1ULL << (idx & 63);
+    }
+
+    constexpr void reset(int idx)
+    {
+        w[idx >> 6] &= ~(1ULL << (idx & 63));
+    }
+
+    constexpr bool any() const
+    {
+        uint64_t bits = 0;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            bits |= w[i];
+        }
+        return bits != 0;
+    }
+
+    int count() const
+    {
+        int bits = 0;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            bits += __builtin_popcountll(w[i]);
+        }
+        return bits;
+    }
+
+    /**
+     * @brief index of the lowest cell in the set, -1 if empty
+     *
+     */
+    int lowest() const
+    {
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            if (w[i])
+            {
+                return i * 64 + __builtin_ctzll(w[i]);
+            }
+        }
+        return -1;
+    }
+
+    constexpr Bitboard operator|(const Bitboard rhs) const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            b.w[i] = w[i] | rhs.w[i];
+        }
+        return b;
+    }
+
+    constexpr Bitboard operator&(const Bitboard rhs) const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            b.w[i] = w[i] & rhs.w[i];
+        }
+        return b;
+    }
+
+    constexpr Bitboard operator^(const Bitboard rhs) const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            b.w[i] = w[i] ^ rhs.w[i];
+        }
+        return b;
+    }
+
+    // complement within the BOARD_CELLS cells of the board
+    constexpr Bitboard operator~() const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            b.w[i] = ~w[i];
+        }
+        b.w[BOARD_WORDS - 1] &= LAST_WORD_MASK;
+        return b;
+    }
+
+    constexpr bool operator==(const Bitboard rhs) const
+    {
+        bool equal = true;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            equal = equal && w[i] == rhs.w[i];
+        }
+        return equal;
+    }
+
+    // shifts by 0 < n < 64, carrying bits across words
+    constexpr Bitboard operator<<(int n) const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = BOARD_WORDS - 1; i > 0; i--)
+        {
+            b.w[i] = (w[i] << n) | (w[i - 1] >> (64 - n));
+        }
+        b.w[0] = w[0] << n;
+        b.w[BOARD_WORDS - 1] &= LAST_WORD_MASK;
+        return b;
+    }
+
+    constexpr Bitboard operator>>(int n) const
+    {
+        Bitboard b = {{0, 0}};
+        for (int i = 0; i < BOARD_WORDS - 1; i++)
+        {
+            b.w[i] = (w[i] >> n) | (w[i + 1] << (64 - n));
+        }
+        b.w[BOARD_WORDS - 1] = w[BOARD_WORDS - 1] >> n;
+        return b;
+    }
+};
+
 /**
  * @brief GameState class, representation of game states
  *
@@ -55,8 +324,54 @@ struct ActionPrior
 class GameState
 {
 private:
-    signed char board[11][11];
+    signed char board[BOARD_SIZE][BOARD_SIZE];
     int totalPieces;
+    // stones placed on dead and captured cells, not counted as moves
+    int filledPieces;
+    // red stones, black stones
+    Bitboard stones[2];
+    uint64_t zobristKey;
+    // key of the board rotated by 180 degrees, colors kept
+    uint64_t rotatedKey;
+    // neighborhood code of every cell, kept up to date as stones are placed
+    std::array<unsigned short, BOARD_CELLS> neighborCodes;
+    // cell of the move of each ply, NO_MOVE before a setState
+    std::array<cell_t, BOARD_CELLS> history;
+    // union find over stones: parent cell of each stone, and edges reached by each group
+    // root, bit 0 first and bit 1 last row or column of the group's color
+    std::array<cell_t, BOARD_CELLS> groupParent;
+    std::array<unsigned char, BOARD_CELLS> groupEdges;
+    // bit 0: red connects its edges, bit 1: black does
+    unsigned char connectedSides;
+
+    /**
+     * @brief update the neighborhood codes around a new stone
+     *
+     * @param x
+     * @param y
+     * @param value 1 red, 2 black
+     */
+    void updateNeighborCodes(int x, int y, int value);
+
+    int findGroup(int cell);
+
+    /**
+     * @brief join a new stone with the groups of its color next to it
+     *
+     * @param x
+     * @param y
+     * @param isRed
+     */
+    void joinGroups(int x, int y, bool isRed);
+
+    /**
+     * @brief edges isRed would reach by playing an empty cell, bits as groupEdges
+     *
+     * @param cell
+     * @param isRed
+     * @return int
+     */
+    int edgesAfter(int cell, bool isRed);
 
 public:
     /**
@@ -73,7 +388,7 @@ public:
      */
     bool boardIsFull();
 
-    void setState(signed char b[][11]);
+    void setState(signed char b[][BOARD_SIZE]);
 
     /**
      * @brief Recover game state from server output
@@ -98,801 +413,4634 @@ public:
     bool redPlayedLast();
 
     /**
-     * @brief next player plays action
+     * @brief Get the number of pieces on board
      *
-     * @param action the action next player takes
-     * @return true
-     * @return false
+     * @return int
      */
-    bool plays(int action);
+    int getTotalPieces();
 
     /**
-     * @brief 2d action version of the same method "plays"
+     * @brief Get the Zobrist key of current position, maintained incrementally in plays
      *
-     * @param x action//11
-     * @param y action%11
-     * @return true
-     * @return false
+     * @return uint64_t
      */
-    bool plays(action2D action);
+    uint64_t getZobristKey();
 
     /**
-     * @brief check that given the current game state, if the game ends
+     * @brief cell of the move played at a ply
      *
-     * @return int 0: not end, 1: red ends, -1: black wins
+     * @param ply 0 for the first move
+     * @return int cell index, -1 if out of range or unknown
      */
-    int checkTermination();
+    int moveAt(int ply);
 
     /**
-     * @brief check if last player wins
+     * @brief Get the canonical key, same for a position and its 180 degree rotation
      *
-     * @return true last player won
-     * @return false game not ending
+     * @return uint64_t the smaller of the key and the rotated key
      */
-    bool lastPlayerWon();
+    uint64_t getCanonicalKey();
 
     /**
-     * @brief Check if one side has won
+     * @brief canonical key of the position after the next player plays action
      *
-     * @param isRed if the side to check is red player
-     * @return true
-     * @return false
+     * @param action
+     * @return uint64_t
      */
-    bool oneSideTest(bool isRed);
+    uint64_t canonicalKeyAfter(action2D action);
 
     /**
-     * @brief print the board of the game
+     * @brief if the canonical orientation is the rotated board, moves keyed by the
+     * canonical key have to be rotated to apply to this board
      *
+     * @return true
+     * @return false
      */
-    void printBoard();
+    bool canonicalIsRotated();
 
     /**
-     * @brief output legal play locations and prior heuristics
+     * @brief map a move to the board rotated by 180 degrees, its own inverse
      *
-     * @param forcedFirst the first hand is forced
-     * @param forcedPlay forced play position
+     * @param action
+     * @return action2D
      */
-    std::vector<ActionPrior> outputActionPrior(bool forcedFirst = true, action2D forcedPlay = {1, 2});
-};
-
-/**
- * @brief Node class for MCTS
- *
- */
-class MCTSNode
-{
-private:
-    MCTSNode *_parent;
-    std::unordered_map<action2D, std::unique_ptr<MCTSNode>> _children;
-    int _nVisits;
-    float _quality;
-    float _uct;
-    float _heuristicFactor;
-    bool _isRed;
+    static action2D rotate(action2D action);
 
-public:
-    MCTSNode(MCTSNode *node, float heuristic, bool isRed);
     /**
-     * @brief expand a node, fill new nodes with action priors
+     * @brief 12 bit code of the 6 neighbors of a cell in ring order, 2 bits each:
+     * 0 empty, 1 red or red border, 2 black or black border, 3 off board corner,
+     * read from the codes kept up to date as stones are placed
      *
+     * @param x
+     * @param y
+     * @return int
      */
-    void expand(std::vector<ActionPrior> apPairs);
+    int neighborhoodCode(int x, int y);
 
     /**
-     * @brief evaluate a node based on UCT, quality, and heuristics
+     * @brief classify empty cells as dead, captured or dominated by neighborhood patterns
      *
-     * @return float evaluation result
+     * @param inferior filled with INFERIOR_* values, 0 for cells that have to be considered
+     * @param withDominated also mark cells dominated for the player to move
      */
-    float evaluation(float xplorCoeff);
-
-    std::unordered_map<action2D, std::unique_ptr<MCTSNode>> *getChildren();
+    void classifyInferior(signed char inferior[][BOARD_SIZE], bool withDominated = true);
 
     /**
-     * @brief return if this node belongs to red player
+     * @brief fill dead cells and captured cells with stones, without passing the turn
      *
-     * @return true
-     * @return false
+     * @return int number of stones placed
      */
-    bool isRed();
+    int fillInferiorCells();
 
     /**
-     * @brief expose a node object by printing
+     * @brief Get the stones of one side
      *
+     * @param isRed
+     * @return Bitboard
      */
-    void expose();
+    Bitboard getStones(bool isRed);
 
     /**
-     * @brief Set the Parent Null
+     * @brief empty cells of the board
      *
+     * @return Bitboard
      */
-    void setParentNull();
+    Bitboard emptyCells();
 
     /**
-     * @brief greedily select a node based on exploration coefficient
+     * @brief cells where one stone of a side connects its two edges
      *
-     * @param explorationCoeff exploration coefficient
-     * @param isPlayout if the function is called during playout(during true play, uses another criterion)
-     * @return int
+     * @param isRed
+     * @return Bitboard
      */
-    std::unordered_map<action2D, std::unique_ptr<MCTSNode>>::iterator select(float xplorCoeff, bool isPlayout = true);
+    Bitboard winningCells(bool isRed);
 
     /**
-     * @brief update a node with returned result
+     * @brief first empty cell winning at once for a side, found from the groups
      *
-     * @param result result from rollout
+     * @param isRed
+     * @return int cell index, -1 if there is none
      */
-    void update(float result);
+    int decisiveCell(bool isRed);
 
     /**
-     * @brief recursively select parent until root and update
+     * @brief cell the player to move has to play: its own winning cell, else a cell
+     * blocking an opponent's winning cell
      *
-     * @param result
+     * @return int cell index, -1 if no move is forced
      */
-    void update_from_root(float result);
+    int forcedCell();
 
     /**
-     * @brief if a node is leaf
+     * @brief if a side is connected through stones, bridges and edge bridges with disjoint
+     * empty carriers after playing cell, so the connection holds whatever the opponent does
      *
+     * @param isRed side to test
+     * @param cell cell index the side plays first, -1 for none
+     * @param carrier set to the empty cells the connection relies on
      * @return true
      * @return false
      */
-    bool isLeaf();
+    bool virtualWinAfter(bool isRed, int cell, Bitboard &carrier);
 
     /**
-     * @brief if a node is root
+     * @brief cells the player to move has to play to avoid losing at once: own winning
+     * cells, cells blocking a one-move win, or cells intersecting every move that gives
+     * the opponent an unbreakable bridge connection
      *
-     * @return true
+     * @param region set to the must-play cells
+     * @return true if moves have to be restricted to region
      * @return false
      */
-    bool isRoot();
-};
-
-class MCTS
-{
-private:
-    std::unique_ptr<MCTSNode> _root;
-
-    float _xplorCoeff;
-    time_t _timeLimit;
-    GameState _state;
-    int _rolloutCounter;
+    bool mustPlayRegion(Bitboard &region);
 
-public:
     /**
-     * @brief Construct a new MCTS object
+     * @brief two-distance of every cell from one edge of a side, by breadth first search
+     * over all cells at once: an empty cell is one further than the second closest of its
+     * neighbors, own stones connect at no cost
      *
-     * @param explorationCoeff
-     * @param startTime
-     * @param timeLimit
+     * @param isRed side whose edges and stones are used
+     * @param fromLast false: first row or column, true: last one
+     * @param distance filled per cell, UNREACHED where the edge cannot be reached
      */
-    MCTS(float explorationCoeff = 0.5, time_t timeLimit = 1000);
+    void edgeDistances(bool isRed, bool fromLast, std::array<cell_t, BOARD_CELLS> &distance);
 
     /**
-     * @brief Get the State object
+     * @brief smallest sum of the two-distances to both edges of a side over empty cells,
+     * 0 once the side is connected
      *
-     * @return GameState
+     * @param isRed
+     * @return int UNREACHED if the side cannot connect anymore
      */
-    GameState getState();
+    int potential(bool isRed);
 
     /**
-     * @brief Set the State object
+     * @brief static evaluation from the two-distance potentials of both sides, the player
+     * to move is given a tempo
      *
-     * @param state
+     * @return float in (-1, 1), positive when red is ahead
      */
-    void setState(GameState state);
+    float evaluate();
 
     /**
-     * @brief Get the Root object
+     * @brief every empty cell of the board, without heuristic filtering
      *
-     * @return MCTSNode*
+     * @param cells filled in row-major order
      */
-    MCTSNode *getRoot();
+    void legalCells(CellBuffer &cells);
 
     /**
-     * @brief Get the Rollout Counter object
+     * @brief legalCells as a vector of actions
      *
-     * @return int
+     * @return std::vector<action2D>
      */
-    int getRolloutCounter();
-
-    MCTSNode *getNodeForAction(action2D action);
+    std::vector<action2D> legalActions();
 
     /**
-     * @brief Set the Root object
+     * @brief next player plays action
      *
+     * @param action the action next player takes
+     * @return true
+     * @return false
      */
-    void setRoot(MCTSNode *root);
+    bool plays(int action);
 
     /**
-     * @brief a wraper for gameState recovery from GameState class
+     * @brief 2d action version of the same method "plays"
      *
+     * @param x action / BOARD_SIZE
+     * @param y action % BOARD_SIZE
+     * @return true
+     * @return false
      */
-    void gameStateRecover();
+    bool plays(action2D action);
 
     /**
-     * @brief playout until leaf node and do rollout
+     * @brief check that given the current game state, if the game ends
      *
+     * @return int 0: not end, 1: red ends, -1: black wins
      */
-    void playout(GameState state_copy);
+    int checkTermination();
 
     /**
-     * @brief naive rollout
+     * @brief check if last player wins
      *
-     * @param startNode
-     * @param state
+     * @return true last player won
+     * @return false game not ending
      */
-    void singleRollout(MCTSNode *startNode, GameState state, int counter);
+    bool lastPlayerWon();
 
     /**
-     * @brief branching every 32 actions, start with 2 branches,
+     * @brief Check if one side has won
      *
-     * @param startNode
-     * @param state
-     * @param counter
-     * @param search_indicator: normally 0 during non-branching, 1 for original thread, 2 for split thread
+     * @param isRed if the side to check is red player
+     * @return true
+     * @return false
      */
-    void branchingRollout(MCTSNode *startNode, GameState state, int counter, int search_indicator = 0);
+    bool oneSideTest(bool isRed);
 
     /**
-     * @brief Get the next move through playout and rollout
+     * @brief print the board of the game
      *
-     * @return int representing next move
      */
-    action2D getNextMove(time_t startTime, float timeMultiplier = 1.0);
+    void printBoard();
 
     /**
-     * @brief update MCTS internals with selected move
+     * @brief legal play locations and prior heuristics
      *
+     * @param moves filled with the candidates in row-major order
+     * @param forcedFirst the first hand is forced
+     * @param forcedPlay forced play position
+     * @param openingRange keep the first moves off the border rows
      */
-    void updateWithMove(action2D action);
+    void generateMoves(MoveBuffer &moves, bool forcedFirst = true, action2D forcedPlay = {1, 2}, bool openingRange = true);
+
+    /**
+     * @brief generateMoves as a vector of actions and priors
+     *
+     * @param forcedFirst the first hand is forced
+     * @param forcedPlay forced play position
+     */
+    std::vector<ActionPrior> outputActionPrior(bool forcedFirst = true, action2D forcedPlay = {1, 2});
+
+    /**
+     * @brief rollout move from the lookup tables: the reply saving a bridge or edge template
+     * the last move intruded, else the empty cell of highest pattern weight
+     *
+     * @param half 0: all cells, 1: first half, 2: second half of the cells in range,
+     * the second half skips the bridge reply so branches differ
+     * @return action2D
+     */
+    action2D rolloutAction(int half = 0);
 };
-//*********************************END of Headers
 
-// Helper functions
-Json::Value act2act(action2D action)
+// Search policies. MCTSEngine takes one of each as a template argument, so every bot is an
+// instantiation of the same engine and the policies are resolved at compile time
+
+/**
+ * @brief Selection policy: UCT over the mean result and the prior weighted exploration term
+ *
+ */
+struct UctSelection
 {
-    Json::Value jAction;
-    jAction["x"] = action.actionX;
-    jAction["y"] = action.actionY;
-    return jAction;
+    // no statistics beyond visits and quality
+    struct Amaf
+    {
+    };
+    static const bool USES_AMAF = false;
+    static const int GRAVE_THRESHOLD = 0;
+    static const bool SPARSE_AMAF = false;
+    // default exploration coefficient of the engine
+    static constexpr float EXPLORATION = 0.5;
+
+    /**
+     * @brief value of a child before its exploration term
+     *
+     * @param quality mean result of the child
+     * @param visits visits of the child
+     * @param amaf unused
+     * @return float
+     */
+    static float value(float quality, int /*visits*/, const Amaf * /*amaf*/) { return quality; }
+
+    /**
+     * @brief exploration term of a child, heuristic * c * sqrt(2 ln N) / (1 + n)
+     *
+     * @param heuristic prior of the child
+     * @param xplorCoeff exploration coefficient
+     * @param parentVisits visits of the parent
+     * @param visits visits of the child
+     * @return float
+     */
+    static float exploration(float heuristic, float xplorCoeff, int parentVisits, int visits)
+    {
+        return heuristic * xplorCoeff * sqrt(2 * log(parentVisits)) / (1 + visits);
+    }
+
+    /**
+     * @brief unused, no AMAF statistics are kept
+     *
+     */
+    static void record(Amaf & /*amaf*/, float /*result*/) {}
+};
+
+/**
+ * @brief Selection policy: UCT of the original bot, the prior and the coefficient are taken
+ * under the square root with ln N
+ *
+ */
+struct OriginalSelection : UctSelection
+{
+    static constexpr float EXPLORATION = 1.96;
+
+    /**
+     * @brief exploration term of a child, sqrt(heuristic * c * ln N) / (1 + n)
+     *
+     */
+    static float exploration(float heuristic, float xplorCoeff, int parentVisits, int visits)
+    {
+        return sqrt(heuristic * xplorCoeff * log(parentVisits)) / (1 + visits);
+    }
+};
+
+// visits at which RAVE and the mean result weigh the same
+const float RAVE_EQUIVALENCE = 50;
+
+/**
+ * @brief Selection policy: RAVE, the mean result is blended with the all-moves-as-first result
+ * of the move while the child has few visits
+ *
+ * @tparam GRAVE_VISITS GRAVE: nodes with fewer visits use the AMAF statistics of the closest
+ * ancestor with this many visits and the same player to move, 0 for plain RAVE
+ * @tparam SPARSE with GRAVE, AMAF statistics are only updated at nodes that can be a reference
+ */
+template <int GRAVE_VISITS = 0, bool SPARSE = false>
+struct RaveSelection
+{
+    struct Amaf
+    {
+        int moves;
+        // mean win or loss of the rollouts the move was played in, from the view of its player
+        float quality;
+    };
+    static const bool USES_AMAF = true;
+    static const int GRAVE_THRESHOLD = GRAVE_VISITS;
+    static const bool SPARSE_AMAF = SPARSE && GRAVE_VISITS > 0;
+    static constexpr float EXPLORATION = 1.0;
+
+    static float value(float quality, int visits, const Amaf *amaf)
+    {
+        if (amaf == nullptr || amaf->moves == 0)
+        {
+            return quality;
+        }
+        float weight = sqrt(RAVE_EQUIVALENCE / (3 * visits + RAVE_EQUIVALENCE));
+        return (1 - weight) * quality + weight * amaf->quality;
+    }
+
+    static float exploration(float heuristic, float xplorCoeff, int parentVisits, int visits)
+    {
+        return UctSelection::exploration(heuristic, xplorCoeff, parentVisits, visits);
+    }
+
+    static void record(Amaf &amaf, float result)
+    {
+        amaf.moves += 1;
+        amaf.quality += ((result > 0 ? 1 : -1) - amaf.quality) / amaf.moves;
+    }
+};
+
+/**
+ * @brief Backup policy: results shrink by 0.95 per ply on the way to the root and by 0.995
+ * per rollout move, so quicker wins count more
+ *
+ */
+struct DiscountedBackup
+{
+    static constexpr double PLY_DISCOUNT = 0.95;
+    static constexpr double MOVE_DISCOUNT = 0.995;
+};
+
+/**
+ * @brief Backup policy: results are backed up unchanged, only their sign alternates
+ *
+ */
+struct PlainBackup
+{
+    static constexpr double PLY_DISCOUNT = 1.0;
+    static constexpr double MOVE_DISCOUNT = 1.0;
+};
+
+/**
+ * @brief Node class for MCTS
+ *
+ * @tparam Selection selection policy, UctSelection, OriginalSelection or RaveSelection
+ * @tparam Backup backup policy, DiscountedBackup or PlainBackup
+ */
+template <class Selection, class Backup>
+class SearchNode
+{
+private:
+    SearchNode *_parent;
+    std::unordered_map<action2D, std::unique_ptr<SearchNode>> _children;
+    int _nVisits;
+    float _quality;
+    float _uct;
+    float _heuristicFactor;
+    bool _isRed;
+    // 1: player of this node proven to win, -1: proven to lose, 0: unknown
+    signed char _proof;
+    typename Selection::Amaf _amaf;
+
+public:
+    SearchNode(SearchNode *node, float heuristic, bool isRed);
+    /**
+     * @brief expand a node, fill new nodes with action priors
+     *
+     */
+    void expand(const MoveBuffer &moves);
+
+    /**
+     * @brief evaluate a node based on UCT, quality, and heuristics
+     *
+     * @param amafSource node holding the AMAF statistics of this move, the node itself unless
+     * GRAVE picks a reference, nullptr if there are none
+     * @return float evaluation result
+     */
+    float evaluation(float xplorCoeff, const SearchNode *amafSource = nullptr);
+
+    std::unordered_map<action2D, std::unique_ptr<SearchNode>> *getChildren();
+
+    /**
+     * @brief return if this node belongs to red player
+     *
+     * @return true
+     * @return false
+     */
+    bool isRed();
+
+    /**
+     * @brief Get the proven result of this node
+     *
+     * @return int 1: player of this node wins, -1: player of this node loses, 0: unknown
+     */
+    int getProof();
+
+    /**
+     * @brief Set the proven result of this node
+     *
+     * @param proof 1: player of this node wins, -1: player of this node loses
+     */
+    void setProof(int proof);
+
+    /**
+     * @brief Get the visit count of this node
+     *
+     * @return int
+     */
+    int getVisits();
+
+    /**
+     * @brief Get the mean result of this node, from the view of its player
+     *
+     * @return float
+     */
+    float getQuality();
+
+    /**
+     * @brief Get the prior heuristic of this node
+     *
+     * @return float
+     */
+    float getPrior();
+
+    /**
+     * @brief expose a node object by printing
+     *
+     */
+    void expose();
+
+    /**
+     * @brief Set the Parent Null
+     *
+     */
+    void setParentNull();
+
+    /**
+     * @brief greedily select a node based on exploration coefficient
+     *
+     * @param explorationCoeff exploration coefficient
+     * @param isPlayout if the function is called during playout(during true play, uses another criterion)
+     * @param reference GRAVE reference node whose children hold the AMAF statistics, nullptr
+     * or this node for the children's own
+     * @return int
+     */
+    typename std::unordered_map<action2D, std::unique_ptr<SearchNode>>::iterator select(float xplorCoeff, bool isPlayout = true, SearchNode *reference = nullptr);
+
+    /**
+     * @brief visit counts of the child select(_, false) plays and of the most visited other
+     * child not proven lost, the only one that can still overtake it
+     *
+     * @param best
+     * @param second
+     */
+    void topTwoVisits(int &best, int &second);
+
+    /**
+     * @brief update a node with returned result
+     *
+     * @param result result from rollout
+     * @param finalState position the rollout ended in, the AMAF statistics of the children are
+     * updated from its stones; nullptr to leave them
+     */
+    void update(float result, GameState *finalState);
+
+    /**
+     * @brief recursively select parent until root and update
+     *
+     * @param result
+     * @param finalState
+     */
+    void update_from_root(float result, GameState *finalState = nullptr);
+
+    /**
+     * @brief if a node is leaf
+     *
+     * @return true
+     * @return false
+     */
+    bool isLeaf();
+
+    /**
+     * @brief if a node is root
+     *
+     * @return true
+     * @return false
+     */
+    bool isRoot();
+};
+
+/**
+ * @brief Cheap clock for deadline checks during search.
+ * Reads the TSC calibrated against steady_clock on x86, CLOCK_MONOTONIC_COARSE elsewhere,
+ * both without a syscall
+ *
+ */
+class SearchClock
+{
+private:
+    double _ticksPerMs;
+    uint64_t _baseTicks;
+    double _baseMs;
+
+public:
+    /**
+     * @brief Construct a new Search Clock object, spins about 2ms to calibrate the TSC
+     *
+     */
+    SearchClock();
+
+    /**
+     * @brief milliseconds on the getTimeInMilis clock, with sub-millisecond precision on x86
+     *
+     * @return double
+     */
+    double now();
+
+    /**
+     * @brief anchor the clock to steady_clock again, and refine the TSC rate over the time
+     * since the last anchor, so the rate error of the calibration never builds up over a game.
+     * Not thread safe, called between turns while no solver reads the clock
+     *
+     */
+    void rebase();
 };
 
-std::vector<action2D> findLinkedNodes(action2D action, std::vector<action2D> &pieceList)
+/**
+ * @brief Depth-first proof-number solver, runs on a spare core alongside MCTS
+ *
+ */
+class DfpnSolver
+{
+private:
+    struct TTEntry
+    {
+        uint64_t key;
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    std::vector<TTEntry> _table;
+    uint64_t _tableMask;
+    std::thread _worker;
+    std::atomic<bool> _stop;
+    std::atomic<bool> _solved;
+    action2D _bestMove;
+    time_t _deadline;
+    long _nodeCounter;
+
+    /**
+     * @brief read proof and disproof number of a position, (1, 1) if not stored
+     *
+     */
+    void lookupEntry(uint64_t key, uint32_t &phi, uint32_t &delta);
+
+    void storeEntry(uint64_t key, uint32_t phi, uint32_t delta);
+
+    /**
+     * @brief if the search should stop, polls the clock every 256 nodes
+     *
+     */
+    bool outOfTime();
+
+    /**
+     * @brief multiple iterative deepening, expand state until one threshold is exceeded
+     *
+     * @param state position with the player to move as OR node
+     * @param phiThreshold
+     * @param deltaThreshold
+     */
+    void mid(GameState &state, uint32_t phiThreshold, uint32_t deltaThreshold);
+
+    void run(GameState state);
+
+public:
+    /**
+     * @brief Construct a new Dfpn Solver object
+     *
+     * @param tableBits log2 of transposition table entries
+     */
+    DfpnSolver(int tableBits = 20);
+
+    ~DfpnSolver();
+
+    /**
+     * @brief start solving state on a worker thread until deadline
+     *
+     * @param state
+     * @param deadline in milliseconds, same clock as getTimeInMilis
+     */
+    void start(GameState state, time_t deadline);
+
+    /**
+     * @brief cancel the search and join the worker thread
+     *
+     */
+    void stop();
+
+    /**
+     * @brief if the position given to start is proven to be a win for the player to move
+     *
+     * @return true
+     * @return false
+     */
+    bool solved();
+
+    /**
+     * @brief Get the winning move, valid only if solved
+     *
+     * @return action2D
+     */
+    action2D getBestMove();
+
+    /**
+     * @brief look up a proven result in the transposition table
+     *
+     * @param state
+     * @return int 1: player to move wins, -1: player to move loses, 0: unknown
+     */
+    int lookup(GameState &state);
+};
+
+/**
+ * @brief Virtual connections of one side found by H-search, kept up to date across moves.
+ * Points are empty cells, groups of own stones and the two edges. A full connection holds
+ * whatever the opponent plays in its carrier, a semi connection needs one more move, its key.
+ * A new stone only drops or shrinks the connections it touches, the rest carries over
+ *
+ */
+class VCEngine
+{
+public:
+    static const int EDGE_START = BOARD_CELLS;
+    static const int EDGE_END = BOARD_CELLS + 1;
+    static const int POINTS = BOARD_CELLS + 2;
+
+private:
+    struct SemiConnection
+    {
+        Bitboard carrier;
+        int key;
+    };
+
+    struct PendingAnd
+    {
+        int x;
+        int y;
+        Bitboard carrier;
+    };
+
+    bool _isRed;
+    // size limits: connections kept per pair, semi connections combined by one OR
+    int _maxFull;
+    int _maxSemi;
+    int _maxOr;
+    // union find over points, own stones share the root of their group, an edge if they touch it
+    std::array<int, POINTS> _parent;
+    Bitboard _mine;
+    Bitboard _empty;
+    // connections of the pair x < y at x * POINTS + y, carriers hold empty cells only
+    std::vector<std::vector<Bitboard>> _full;
+    std::vector<std::vector<SemiConnection>> _semi;
+    // full connections not yet combined by the AND rule
+    std::vector<PendingAnd> _pending;
+    size_t _pendingHead;
+
+    int find(int point);
+
+    void unite(int a, int b);
+
+    int pairIndex(int x, int y);
+
+    /**
+     * @brief if point is an empty cell, or the root of a group or an edge
+     *
+     */
+    bool isPoint(int point);
+
+    /**
+     * @brief point of a cell that is empty or holds an own stone
+     *
+     */
+    int pointOf(int cell);
+
+    /**
+     * @brief store a full connection unless a smaller one is known, queue it for the AND rule
+     *
+     */
+    void addFull(int x, int y, Bitboard carrier);
+
+    /**
+     * @brief store a semi connection unless a smaller one is known, then try the OR rule
+     *
+     */
+    void addSemi(int x, int y, Bitboard carrier, int key);
+
+    /**
+     * @brief OR rule: semi connections of a pair with disjoint carriers make a full connection
+     *
+     */
+    void combine(int x, int y);
+
+    /**
+     * @brief AND rule: chain a full connection with the full connections of either endpoint
+     *
+     */
+    void andRule(PendingAnd &vc);
+
+public:
+    /**
+     * @brief Construct a new VCEngine object on the empty board
+     *
+     * @param isRed side whose connections are searched
+     * @param maxFull full connections kept per pair
+     * @param maxSemi semi connections kept per pair
+     * @param maxOr semi connections combined by one OR
+     */
+    VCEngine(bool isRed, int maxFull = 4, int maxSemi = 8, int maxOr = 4);
+
+    /**
+     * @brief drop all connections and seed adjacent points of state, search is left to search()
+     *
+     * @param state
+     */
+    void reset(GameState &state);
+
+    /**
+     * @brief update connections with a stone of either side
+     *
+     * @param cell cell index of the stone
+     * @param isRed side of the stone
+     */
+    void play(int cell, bool isRed);
+
+    /**
+     * @brief run H-search until no rule applies or deadline, can be resumed by a later call
+     *
+     * @param deadline in milliseconds, searchClock time
+     * @return true if complete
+     * @return false if cut by the deadline
+     */
+    bool search(double deadline);
+
+    /**
+     * @brief if the edges are connected by stones or by a full connection
+     *
+     * @param carrier set to the smallest carrier
+     * @return true
+     * @return false
+     */
+    bool connected(Bitboard &carrier);
+
+    /**
+     * @brief keys of semi connections between the edges, each one wins on the spot
+     *
+     * @return Bitboard
+     */
+    Bitboard winningKeys();
+
+    /**
+     * @brief intersection of the carriers of semi connections between the edges,
+     * the opponent loses by playing outside of it
+     *
+     * @param region
+     * @return true if there is a semi connection
+     * @return false
+     */
+    bool threats(Bitboard &region);
+};
+
+/**
+ * @brief Time manager aware of the judge's per-turn limits, banks time saved on easy moves
+ *
+ */
+class TimeManager
+{
+private:
+    time_t _turnLimit;
+    time_t _firstTurnLimit;
+    // fraction of the judge limit never exceeded, leaves room for output
+    float _safetyRatio;
+    // judge measures process cpu time instead of wall time
+    bool _limitOnCpu;
+    int _turn;
+    time_t _turnStart;
+    time_t _turnCpuStart;
+    time_t _softBudget;
+    // soft budget of a middle game turn, what plan cuts from it for forced, opening and late
+    // moves is banked as well
+    time_t _standardBudget;
+    time_t _hardBudget;
+    time_t _timeBank;
+    // bound of deadline overshoot in milliseconds, sets how often the clock is read
+    double _checkInterval;
+
+public:
+    /**
+     * @brief Construct a new Time Manager object
+     *
+     * @param turnLimit judge limit of every turn but the first, in milliseconds
+     * @param firstTurnLimit judge limit of the first turn, in milliseconds
+     * @param limitOnCpu if the judge counts cpu time of all threads
+     * @param checkInterval bound of deadline overshoot in milliseconds
+     */
+    TimeManager(time_t turnLimit = 1000, time_t firstTurnLimit = 2000, bool limitOnCpu = false, double checkInterval = 1.0);
+
+    /**
+     * @brief start timing a turn
+     *
+     * @param startTime when the request was received, from getTimeInMilis
+     * @param timeMultiplier scale of the judge limits for this turn
+     */
+    void startTurn(time_t startTime, float timeMultiplier = 1.0);
+
+    /**
+     * @brief allocate soft and hard budgets of the turn
+     *
+     * @param totalPieces pieces on board
+     * @param candidates number of candidate moves at root
+     */
+    void plan(int totalPieces, int candidates);
+
+    /**
+     * @brief milliseconds used in this turn, on the clock the judge measures
+     *
+     * @return time_t
+     */
+    time_t elapsed();
+
+    /**
+     * @brief milliseconds until the search has to stop
+     *
+     * @param critical if the position deserves time beyond the soft budget
+     * @return time_t
+     */
+    time_t remaining(bool critical);
+
+    /**
+     * @brief if the search should stop now
+     *
+     * @param critical if the position deserves time beyond the soft budget
+     * @return true
+     * @return false
+     */
+    bool shouldStop(bool critical);
+
+    /**
+     * @brief the hard deadline of the turn, on the getTimeInMilis clock
+     *
+     * @return time_t
+     */
+    time_t hardDeadline();
+
+    /**
+     * @brief last moment a response can be written before the judge limit, for the watchdog
+     *
+     * @return time_t
+     */
+    time_t emergencyDeadline();
+
+    /**
+     * @brief number of playouts to run before the next deadline check
+     *
+     * @param msPerPlayout measured cost of one playout in milliseconds
+     * @return int
+     */
+    int nextBatch(double msPerPlayout);
+
+    /**
+     * @brief finish the turn, bank what was left of the soft budget
+     *
+     */
+    void endTurn();
+
+    time_t getTimeBank();
+};
+
+/**
+ * @brief Watchdog armed at the start of each move. At the emergency deadline it aborts the
+ * search cooperatively and writes the best move so far, so a response is always emitted in time
+ *
+ */
+class Watchdog
+{
+private:
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::function<void(action2D)> _emit;
+    bool _armed;
+    bool _quit;
+    bool _responded;
+    time_t _deadline;
+    action2D _emitted;
+    std::atomic<bool> _fired;
+    // actionX * BOARD_SIZE + actionY of the best move so far, -1 if none
+    std::atomic<int> _bestSoFar;
+
+    void run();
+
+public:
+    Watchdog();
+
+    ~Watchdog();
+
+    /**
+     * @brief Set the function writing a response to the judge
+     *
+     * @param emit
+     */
+    void setEmitter(std::function<void(action2D)> emit);
+
+    /**
+     * @brief start a new move, fire at deadline unless disarmed
+     *
+     * @param deadline on the getTimeInMilis clock
+     * @param fallback answered if the deadline passes before setBestSoFar is called
+     */
+    void arm(time_t deadline, action2D fallback);
+
+    /**
+     * @brief stop the timer of this move
+     *
+     * @param emitted set to the move already written if the watchdog fired
+     * @return true the watchdog fired and wrote emitted
+     * @return false
+     */
+    bool disarm(action2D &emitted);
+
+    /**
+     * @brief publish the best move so far, safe to call from the search thread
+     *
+     * @param action
+     */
+    void setBestSoFar(action2D action);
+
+    /**
+     * @brief if the deadline passed and the search has to abort
+     *
+     * @return true
+     * @return false
+     */
+    bool fired();
+
+    /**
+     * @brief write the response of the current move, at most once per move
+     *
+     * @param action
+     */
+    void respond(action2D action);
+};
+
+/**
+ * @brief One record of the opening book, records are sorted by key, a key may have several moves.
+ * Keys are canonical, moves are given on the board in canonical orientation
+ *
+ */
+struct BookRecord
+{
+    uint64_t key;
+    uint32_t visits;
+    float value;
+    uint8_t actionX;
+    uint8_t actionY;
+    uint8_t reserved[6];
+};
+
+/**
+ * @brief Header of the opening book file, followed by count records
+ *
+ */
+struct BookHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+};
+
+/**
+ * @brief Opening book keyed by canonical Zobrist hash, memory mapped so nothing is parsed at startup
+ *
+ */
+class OpeningBook
+{
+private:
+    void *_mapping;
+    size_t _mappingSize;
+    const BookRecord *_records;
+    uint32_t _count;
+
+public:
+    OpeningBook();
+
+    ~OpeningBook();
+
+    /**
+     * @brief map a book file, the book stays empty if the file is missing or malformed
+     *
+     * @param path
+     * @return true
+     * @return false
+     */
+    bool open(const char *path);
+
+    /**
+     * @brief number of records in the book
+     *
+     * @return uint32_t
+     */
+    uint32_t size();
+
+    /**
+     * @brief find the most visited book move of a position
+     *
+     * @param state
+     * @param action set to the book move if found
+     * @return true
+     * @return false
+     */
+    bool probe(GameState &state, action2D &action);
+};
+
+/**
+ * @brief Last good reply with forgetting for rollouts. For each color, the reply that won
+ * the last rollout after the previous two moves, and after the opponent's previous move.
+ * A reply is forgotten when it is played in a lost rollout. Each search owns one table,
+ * about 30KB that stay in cache
+ *
+ */
+class ReplyTable
+{
+private:
+    // [color * BOARD_CELLS * BOARD_CELLS + before last move * BOARD_CELLS + last move]
+    std::vector<cell_t> _afterTwo;
+    // [color * BOARD_CELLS + last move]
+    std::vector<cell_t> _afterOne;
+
+public:
+    ReplyTable();
+
+    /**
+     * @brief stored reply for the player to move, if its cell is still empty
+     *
+     * @param state
+     * @return int cell index, -1 if none
+     */
+    int reply(GameState &state);
+
+    /**
+     * @brief store the replies of the winner and forget the replies of the loser
+     *
+     * @param state final state of the simulation
+     * @param fromPly first ply of the simulation
+     * @param winner 1 red, -1 black
+     */
+    void update(GameState &state, int fromPly, int winner);
+};
+
+/**
+ * @brief Board as a resistor network for one side: own stones conduct freely, empty cells
+ * have unit resistance and opponent stones cut the circuit. Voltages are solved by a
+ * preconditioned conjugate gradient, starting from the voltages of the last solve
+ *
+ */
+class ResistanceEvaluator
+{
+private:
+    // voltages of red and black from the last solve, first edge at 1 and last edge at 0
+    std::array<double, BOARD_CELLS> _voltage[2];
+    // conductances of the circuit being solved, to the neighbors and to both edges
+    std::array<std::array<double, 6>, BOARD_CELLS> _link;
+    std::array<double, BOARD_CELLS> _toFirst;
+    std::array<double, BOARD_CELLS> _toLast;
+    std::array<double, BOARD_CELLS> _diagonal;
+    int _iterations;
+
+    /**
+     * @brief set the conductances of the circuit of one side
+     *
+     * @param state
+     * @param isRed
+     */
+    void buildCircuit(GameState &state, bool isRed);
+
+    /**
+     * @brief y = L x for the Laplacian of the circuit, edges held at fixed voltage
+     *
+     * @param x
+     * @param y
+     */
+    void multiply(const std::array<double, BOARD_CELLS> &x, std::array<double, BOARD_CELLS> &y);
+
+    /**
+     * @brief solve the voltages of the circuit built last
+     *
+     * @param voltage start values, set to the solution
+     */
+    void solve(std::array<double, BOARD_CELLS> &voltage);
+
+    /**
+     * @brief current through every cell, as a fraction of the current between the edges
+     *
+     * @param voltage
+     * @param flow filled per cell
+     * @return double conductance between the edges
+     */
+    double cellFlow(const std::array<double, BOARD_CELLS> &voltage, std::array<double, BOARD_CELLS> &flow);
+
+public:
+    ResistanceEvaluator();
+
+    /**
+     * @brief conductance between the two edges of a side
+     *
+     * @param state
+     * @param isRed
+     * @return double
+     */
+    double conductance(GameState &state, bool isRed);
+
+    /**
+     * @brief replace the priors of the actions by the current both sides' circuits carry
+     * through their cells, 1 for cells without current up to 6 for the busiest cell
+     *
+     * @param state
+     * @param moves
+     */
+    void priors(GameState &state, MoveBuffer &moves);
+
+    /**
+     * @brief conjugate gradient iterations of the last solve
+     *
+     * @return int
+     */
+    int getIterations();
+};
+
+/**
+ * @brief Rollout policy: one rollout per new leaf, moves from the lookup tables
+ *
+ * @tparam PLIES rollouts ending within this many moves of the leaf are rewarded more
+ * @tparam REWARD such a win counts REWARD / (moves + 1)
+ */
+template <int PLIES = 8, int REWARD = 10>
+struct SingleRollout
+{
+    static const bool BRANCHING = false;
+    static const int BATCH = 0;
+    static const int QUICK_WIN_PLIES = PLIES;
+    static const int QUICK_WIN_REWARD = REWARD;
+};
+
+/**
+ * @brief Rollout policy: branchingRollout from every new leaf
+ *
+ * @tparam PLIES rollouts ending within this many moves of the leaf are rewarded more
+ * @tparam REWARD such a win counts REWARD / (moves + 1)
+ */
+template <int PLIES = 10, int REWARD = 16>
+struct BranchingRollout
+{
+    static const bool BRANCHING = true;
+    static const int BATCH = 0;
+    static const int QUICK_WIN_PLIES = PLIES;
+    static const int QUICK_WIN_REWARD = REWARD;
+};
+
+/**
+ * @brief Rollout policy: uniformly random rollouts in lanes from every new leaf, played by
+ * randomRollouts
+ *
+ * @tparam GAMES rollouts per new leaf
+ */
+template <int GAMES>
+struct RandomRollout
+{
+    static_assert(GAMES > 0, "a random rollout batch needs games");
+    static const bool BRANCHING = false;
+    static const int BATCH = GAMES;
+};
+
+/**
+ * @brief Prior policy: the stone count and pattern heuristic of GameState::generateMoves
+ *
+ */
+struct PatternPrior
+{
+    // candidates of the first moves are kept off the border rows
+    static const bool OPENING_RANGE = true;
+
+    /**
+     * @brief replace the priors of the moves, kept as generated
+     *
+     */
+    static void apply(GameState & /*state*/, MoveBuffer & /*moves*/, ResistanceEvaluator & /*resistance*/) {}
+};
+
+/**
+ * @brief Prior policy of the original bot: a stone within range 2 *1.1, both colors around
+ * and one of them twice *1.25, next to the border *0.8, every empty cell from the first move
+ *
+ */
+struct OriginalPrior
+{
+    static const bool OPENING_RANGE = false;
+
+    static void apply(GameState &state, MoveBuffer &moves, ResistanceEvaluator &resistance);
+};
+
+/**
+ * @brief Prior policy of the RAVE bot: a stone within range 2 *1.5, both colors around *1.5,
+ * and *2 more with at least 3 stones around
+ *
+ */
+struct RavePrior
+{
+    static const bool OPENING_RANGE = true;
+
+    static void apply(GameState &state, MoveBuffer &moves, ResistanceEvaluator &resistance);
+};
+
+/**
+ * @brief Prior policy: the current through each cell in the resistance circuits of both sides
+ *
+ */
+struct ResistancePrior
+{
+    static const bool OPENING_RANGE = true;
+
+    static void apply(GameState &state, MoveBuffer &moves, ResistanceEvaluator &resistance)
+    {
+        if (moves.size() > 1)
+        {
+            resistance.priors(state, moves);
+        }
+    }
+};
+
+// rollouts branch at every 32nd move and play fewer than BOARD_CELLS moves
+const int ROLLOUT_BRANCHES = (BOARD_CELLS + 31) / 32;
+
+/**
+ * @brief a branch of a branching rollout put aside, resumed from state after counter moves
+ *
+ */
+struct RolloutBranch
+{
+    GameState state;
+    int counter;
+};
+
+/**
+ * @brief MCTS engine, every bot is an instantiation with its own policies
+ *
+ * @tparam Selection UctSelection, OriginalSelection or RaveSelection
+ * @tparam Rollout SingleRollout, BranchingRollout or RandomRollout
+ * @tparam Prior PatternPrior, OriginalPrior, RavePrior or ResistancePrior
+ * @tparam Backup DiscountedBackup or PlainBackup
+ */
+template <class Selection, class Rollout, class Prior, class Backup>
+class MCTSEngine
+{
+public:
+    typedef SearchNode<Selection, Backup> Node;
+    static constexpr float EXPLORATION = Selection::EXPLORATION;
+
+private:
+    std::unique_ptr<Node> _root;
+
+    float _xplorCoeff;
+    time_t _timeLimit;
+    GameState _state;
+    int _rolloutCounter;
+    DfpnSolver _solver;
+    // solver thread only starts once this many pieces are on board
+    int _solverMinPieces;
+    TimeManager _timeManager;
+    Watchdog _watchdog;
+    // virtual connections of red and black, updated move by move
+    VCEngine _connections[2];
+    ReplyTable _replies;
+    // rollouts stop after this many moves and back up the static evaluation, 0 plays them out
+    int _rolloutCutoff;
+    ResistanceEvaluator _resistance;
+    uint64_t _random;
+    // root move chosen by sequential halving instead of the visit count
+    bool _rootHalving;
+    // branches of the running branching rollout waiting for their split branch to end
+    std::array<RolloutBranch, ROLLOUT_BRANCHES> _pendingBranches;
+
+    /**
+     * @brief extend the virtual connections of both sides until deadline, then mark root
+     * children outside the opponent's threats as lost
+     *
+     * @param deadline in milliseconds, searchClock time
+     * @param action set to a winning move if the player to move has one
+     * @return true if the player to move wins by action
+     * @return false
+     */
+    bool connectionMove(double deadline, action2D &action);
+
+    /**
+     * @brief sequential halving over the root children: the budget is split into
+     * log2(children) rounds, every round gives each candidate the same playouts and
+     * drops the worse half
+     *
+     * @return action2D {-1, -1} if every child is proven lost
+     */
+    action2D halvingMove();
+
+    /**
+     * @brief move the watchdog answers before the search publishes one: the root child of
+     * highest prior not proven lost, else any empty cell
+     *
+     * @return action2D
+     */
+    action2D fallbackMove();
+
+public:
+    /**
+     * @brief Construct a new MCTS object
+     *
+     * @param explorationCoeff defaults to the coefficient of the selection policy
+     * @param startTime
+     * @param timeLimit judge limit per turn in milliseconds, doubled on the first turn
+     * @param solverMinPieces pieces on board before the dfpn solver is started
+     * @param rolloutCutoff moves after which rollouts back up GameState::evaluate, 0 for none
+     * @param rootHalving choose the root move by sequential halving
+     */
+    MCTSEngine(float explorationCoeff = Selection::EXPLORATION, time_t timeLimit = 1000, int solverMinPieces = 40, int rolloutCutoff = 0, bool rootHalving = false);
+
+    /**
+     * @brief Get the State object
+     *
+     * @return GameState
+     */
+    GameState getState();
+
+    /**
+     * @brief Set the State object
+     *
+     * @param state
+     */
+    void setState(GameState state);
+
+    /**
+     * @brief Get the Root object
+     *
+     * @return Node*
+     */
+    Node *getRoot();
+
+    /**
+     * @brief Get the Rollout Counter object
+     *
+     * @return int
+     */
+    int getRolloutCounter();
+
+    /**
+     * @brief Get the time saved on earlier moves and not spent yet
+     *
+     * @return time_t milliseconds
+     */
+    time_t getTimeBank();
+
+    Node *getNodeForAction(action2D action);
+
+    /**
+     * @brief Set the Root object
+     *
+     */
+    void setRoot(Node *root);
+
+    /**
+     * @brief a wraper for gameState recovery from GameState class
+     *
+     */
+    void gameStateRecover();
+
+    /**
+     * @brief playout until leaf node and do rollout
+     *
+     * @param state_copy
+     * @param start root child to start from, state_copy already has its move; nullptr for the root
+     */
+    void playout(GameState state_copy, Node *start = nullptr);
+
+    /**
+     * @brief priors of the children of a node, from the prior policy, restricted to the
+     * must-play region when the opponent threatens to win
+     *
+     * @param state state at the node
+     * @param moves filled with the children and their priors
+     */
+    void expansionPriors(GameState &state, MoveBuffer &moves);
+
+    /**
+     * @brief naive rollout
+     *
+     * @param startNode
+     * @param state
+     */
+    void singleRollout(Node *startNode, GameState state, int counter);
+
+    /**
+     * @brief branching every 32 actions, start with 2 branches, played one after the other
+     * without recursion: the split branch is played first, the rest of the branch waits in
+     * a fixed stack
+     *
+     * @param startNode
+     * @param state
+     * @param counter
+     * @param search_indicator: normally 0 during non-branching, 1 for original thread, 2 for split thread
+     */
+    void branchingRollout(Node *startNode, GameState state, int counter, int search_indicator = 0);
+
+    /**
+     * @brief run a fixed number of playouts from current state without any clock, for offline use
+     *
+     * @param playouts
+     */
+    void search(int playouts);
+
+    /**
+     * @brief Get the next move through playout and rollout
+     *
+     * @return int representing next move
+     */
+    action2D getNextMove(time_t startTime, float timeMultiplier = 1.0);
+
+    /**
+     * @brief account a turn answered without search, e.g. from the opening book, its budget is banked
+     *
+     * @param startTime
+     * @param action the move answered, the watchdog's answer if it is not written in time
+     */
+    void skipSearch(time_t startTime, action2D action);
+
+    /**
+     * @brief update MCTS internals with selected move
+     *
+     */
+    void updateWithMove(action2D action);
+
+    /**
+     * @brief copy proven results of the solver into the tree
+     *
+     * @param node
+     * @param state state at node
+     * @param depth how many plies below node to visit
+     */
+    void importProofs(Node *node, GameState state, int depth);
+
+    /**
+     * @brief Set the function writing a response to the judge, also used by the watchdog
+     *
+     * @param emit
+     */
+    void setResponder(std::function<void(action2D)> emit);
+
+    /**
+     * @brief write the response of the current move unless the watchdog already did
+     *
+     * @param action
+     */
+    void respond(action2D action);
+};
+// the shipped bots
+typedef MCTSEngine<UctSelection, BranchingRollout<>, ResistancePrior, DiscountedBackup> BranchingBot;
+typedef MCTSEngine<OriginalSelection, BranchingRollout<5, 10>, OriginalPrior, PlainBackup> OriginalBot;
+typedef MCTSEngine<RaveSelection<>, BranchingRollout<>, RavePrior, PlainBackup> RaveBot;
+
+// bot built by main, HexMctsOriginal.cpp defines OriginalBot
+#ifndef HEX_BOT
+#define HEX_BOT BranchingBot
+#endif
+typedef HEX_BOT MCTS;
+typedef MCTS::Node MCTSNode;
+//*********************************END of Headers
+
+// Helper functions
+Json::Value act2act(action2D action)
+{
+    Json::Value jAction;
+    jAction["x"] = action.actionX;
+    jAction["y"] = action.actionY;
+    return jAction;
+};
+
+/**
+ * @brief Zobrist hash of one piece, generated by splitmix64 so no table is initialized
+ *
+ * @param action location of the piece
+ * @param isRed color of the piece
+ * @return uint64_t
+ */
+uint64_t zobristFor(action2D action, bool isRed)
+{
+    uint64_t z = 0x9E3779B97F4A7C15ULL * (uint64_t)((action.actionX * BOARD_SIZE + action.actionY) * 2 + (isRed ? 1 : 0) + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// neighbor offsets in ring order, consecutive entries are adjacent cells
+const int RING_DX[6] = {0, -1, -1, 0, 1, 1};
+const int RING_DY[6] = {1, 1, 0, -1, -1, 0};
+
+// values of GameState::classifyInferior
+const signed char INFERIOR_DEAD = 1;
+const signed char INFERIOR_CAPTURED_RED = 2;
+const signed char INFERIOR_CAPTURED_BLACK = 3;
+const signed char INFERIOR_DOMINATED = 4;
+
+// empty entry of move histories and reply tables
+const cell_t NO_MOVE = std::numeric_limits<cell_t>::max();
+
+// two-distance of a cell no edge can reach
+const cell_t UNREACHED = BOARD_CELLS < 200 ? 200 : BOARD_CELLS + 1;
+
+/**
+ * @brief geometry of one cell, looked up in TOPOLOGY instead of bounds tested
+ *
+ */
+struct CellTopology
+{
+    // neighbor in each ring direction, the cell itself past the border
+    cell_t ring[6];
+    // neighbors on the board, in ring order
+    cell_t neighbors[6];
+    int neighborCount;
+    // bridge partners on the board, in ring order, and the two carrier cells of each
+    cell_t bridges[6];
+    cell_t carriers[6][2];
+    int bridgeCount;
+    // lines to red's first and last edge, then to black's
+    unsigned char edgeDistance[4];
+    // cells at distance 1 and at distance 2
+    Bitboard ring1;
+    Bitboard ring2;
+};
+
+/**
+ * @brief distance between two cells on the hex grid
+ *
+ */
+constexpr int hexDistance(int a, int b)
+{
+    int dx = a / BOARD_SIZE - b / BOARD_SIZE, dy = a % BOARD_SIZE - b % BOARD_SIZE;
+    int ax = dx < 0 ? -dx : dx, ay = dy < 0 ? -dy : dy, axy = dx + dy < 0 ? -dx - dy : dx + dy;
+    return ax > ay ? (ax > axy ? ax : axy) : (ay > axy ? ay : axy);
+}
+
+constexpr std::array<CellTopology, BOARD_CELLS> buildTopology()
+{
+    std::array<CellTopology, BOARD_CELLS> table = {};
+    for (int cell = 0; cell < BOARD_CELLS; cell++)
+    {
+        int x = cell / BOARD_SIZE, y = cell % BOARD_SIZE;
+        CellTopology &topology = table[cell];
+        for (int dir = 0; dir < 6; dir++)
+        {
+            int nx = x + RING_DX[dir], ny = y + RING_DY[dir];
+            bool inside = nx >= 0 && nx <= BOARD_LAST && ny >= 0 && ny <= BOARD_LAST;
+            topology.ring[dir] = inside ? nx * BOARD_SIZE + ny : cell;
+            if (inside)
+            {
+                topology.neighbors[topology.neighborCount++] = nx * BOARD_SIZE + ny;
+            }
+        }
+        // the bridge between ring directions dir and dir + 1 is carried by both neighbors
+        for (int dir = 0; dir < 6; dir++)
+        {
+            int next = (dir + 1) % 6;
+            int bx = x + RING_DX[dir] + RING_DX[next], by = y + RING_DY[dir] + RING_DY[next];
+            if (bx >= 0 && bx <= BOARD_LAST && by >= 0 && by <= BOARD_LAST && topology.ring[dir] != cell && topology.ring[next] != cell)
+            {
+                topology.bridges[topology.bridgeCount] = bx * BOARD_SIZE + by;
+                topology.carriers[topology.bridgeCount][0] = topology.ring[dir];
+                topology.carriers[topology.bridgeCount][1] = topology.ring[next];
+                topology.bridgeCount++;
+            }
+        }
+        topology.edgeDistance[0] = x;
+        topology.edgeDistance[1] = BOARD_LAST - x;
+        topology.edgeDistance[2] = y;
+        topology.edgeDistance[3] = BOARD_LAST - y;
+        for (int other = 0; other < BOARD_CELLS; other++)
+        {
+            int distance = hexDistance(cell, other);
+            if (distance == 1)
+            {
+                topology.ring1.set(other);
+            }
+            else if (distance == 2)
+            {
+                topology.ring2.set(other);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr std::array<CellTopology, BOARD_CELLS> TOPOLOGY = buildTopology();
+
+/**
+ * @brief if an empty cell can never help color, given the codes of its 6 neighbors.
+ * Every pair of neighbors the color could use must already be linked around the ring,
+ * directly or through stones of the color, so any path through the cell can bypass it
+ *
+ * @param code neighborhood code, see GameState::neighborhoodCode
+ * @param color 1 red, 2 black
+ */
+constexpr bool uselessTo(int code, int color)
+{
+    int cells[6] = {};
+    for (int i = 0; i < 6; i++)
+    {
+        cells[i] = (code >> (2 * i)) & 3;
+    }
+    for (int u = 0; u < 6; u++)
+    {
+        for (int v = u + 2; v < 6; v++)
+        {
+            if ((cells[u] != 0 && cells[u] != color) || (cells[v] != 0 && cells[v] != color) || (u == 0 && v == 5))
+            {
+                continue;
+            }
+            bool linked = true;
+            for (int w = u + 1; w < v; w++)
+            {
+                linked = linked && cells[w] == color;
+            }
+            bool linkedAround = true;
+            for (int w = v + 1; w < u + 6; w++)
+            {
+                linkedAround = linkedAround && cells[w % 6] == color;
+            }
+            if (!linked && !linkedAround)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief table of neighborhood codes, bit 0: useless to red, bit 1: useless to black
+ *
+ */
+constexpr std::array<unsigned char, 4096> buildInferiorTable()
+{
+    std::array<unsigned char, 4096> table = {};
+    for (int code = 0; code < 4096; code++)
+    {
+        table[code] = (uselessTo(code, 1) ? 1 : 0) | (uselessTo(code, 2) ? 2 : 0);
+    }
+    return table;
+}
+
+constexpr std::array<unsigned char, 4096> INFERIOR_TABLE = buildInferiorTable();
+
+/**
+ * @brief if a cell with this neighborhood is dead, useless to both colors
+ *
+ * @param code
+ * @return true
+ * @return false
+ */
+inline bool isDeadCode(int code)
+{
+    return INFERIOR_TABLE[code] == 3;
+}
+
+/**
+ * @brief neighborhood code with neighbor i replaced
+ *
+ * @param code
+ * @param i ring index of the neighbor
+ * @param value 0 empty, 1 red, 2 black
+ * @return int
+ */
+inline int withNeighbor(int code, int i, int value)
+{
+    return (code & ~(3 << (2 * i))) | (value << (2 * i));
+}
+
+/**
+ * @brief neighborhood code of a cell on the empty board, only its off-board neighbors are set
+ *
+ * @param cell
+ * @param withValues border values as in GameState::neighborhoodCode, or 3 for every border
+ */
+constexpr int borderCode(int cell, bool withValues)
+{
+    int code = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        int nx = cell / BOARD_SIZE + RING_DX[i], ny = cell % BOARD_SIZE + RING_DY[i];
+        bool offX = nx < 0 || nx > BOARD_LAST, offY = ny < 0 || ny > BOARD_LAST;
+        int value = (offX && offY) || !withValues ? 3 : (offX ? 1 : (offY ? 2 : 0));
+        if (offX || offY)
+        {
+            code |= value << (2 * i);
+        }
+    }
+    return code;
+}
+
+constexpr std::array<unsigned short, BOARD_CELLS> buildBorderCodes(bool withValues)
+{
+    std::array<unsigned short, BOARD_CELLS> codes = {};
+    for (int cell = 0; cell < BOARD_CELLS; cell++)
+    {
+        codes[cell] = borderCode(cell, withValues);
+    }
+    return codes;
+}
+
+// neighborhood codes of the empty board, and masks of their border bits
+constexpr std::array<unsigned short, BOARD_CELLS> BORDER_CODES = buildBorderCodes(true);
+constexpr std::array<unsigned short, BOARD_CELLS> BORDER_MASKS = buildBorderCodes(false);
+
+/**
+ * @brief ring index of the cell saving a bridge of color, given the neighborhood of an
+ * opponent stone just played into one of its two carrier cells, -1 if there is none.
+ * The stone sees the bridge as own stone, empty cell, own stone on consecutive neighbors,
+ * an edge of color counts as own stone so edge templates are saved too
+ *
+ * @param code
+ * @param color 1 red, 2 black
+ */
+constexpr int bridgeReply(int code, int color)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (((code >> (2 * i)) & 3) == color && ((code >> (2 * ((i + 1) % 6))) & 3) == 0 && ((code >> (2 * ((i + 2) % 6))) & 3) == color)
+        {
+            return (i + 1) % 6;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief table of neighborhood codes, low 4 bits: ring index + 1 of red's bridge reply,
+ * high 4 bits: black's, 0 for no reply
+ *
+ */
+constexpr std::array<unsigned char, 4096> buildBridgeReplyTable()
+{
+    std::array<unsigned char, 4096> table = {};
+    for (int code = 0; code < 4096; code++)
+    {
+        table[code] = (bridgeReply(code, 1) + 1) | ((bridgeReply(code, 2) + 1) << 4);
+    }
+    return table;
+}
+
+constexpr std::array<unsigned char, 4096> BRIDGE_REPLY_TABLE = buildBridgeReplyTable();
+
+/**
+ * @brief rollout weight of an empty cell from the stones around it, the multipliers of
+ * GameState::outputActionPrior on the 6 neighbors: contact with both colors and crowded cells
+ *
+ * @param code neighborhood code without border bits
+ */
+constexpr float patternWeight(int code)
+{
+    int redPiece = 0, blackPiece = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        redPiece += ((code >> (2 * i)) & 3) == 1;
+        blackPiece += ((code >> (2 * i)) & 3) == 2;
+    }
+    float weight = 1.0;
+    if ((redPiece >= 1 && blackPiece > 1) || (redPiece > 1 && blackPiece >= 1))
+    {
+        weight *= 2;
+    }
+    if (redPiece + blackPiece >= 4)
+    {
+        weight *= 2;
+    }
+    return weight;
+}
+
+constexpr std::array<float, 4096> buildPatternWeights()
+{
+    std::array<float, 4096> table = {};
+    for (int code = 0; code < 4096; code++)
+    {
+        table[code] = patternWeight(code);
+    }
+    return table;
+}
+
+constexpr std::array<float, 4096> PATTERN_WEIGHTS = buildPatternWeights();
+
+constexpr std::array<float, BOARD_CELLS> buildCellWeights()
+{
+    std::array<float, BOARD_CELLS> weights = {};
+    for (int cell = 0; cell < BOARD_CELLS; cell++)
+    {
+        int x = cell / BOARD_SIZE, y = cell % BOARD_SIZE;
+        weights[cell] = x >= 2 && x <= BOARD_LAST - 1 && y >= 2 && y <= BOARD_LAST - 1 ? 1.5 : 1.0;
+    }
+    return weights;
+}
+
+// cells away from the border are preferred
+constexpr std::array<float, BOARD_CELLS> CELL_WEIGHTS = buildCellWeights();
+
+constexpr Bitboard boardMask(bool (*inside)(int, int))
+{
+    Bitboard b = {{0, 0}};
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            if (inside(i, j))
+            {
+                b.set(i * BOARD_SIZE + j);
+            }
+        }
+    }
+    return b;
+}
+
+constexpr Bitboard ROW_FIRST = boardMask([](int i, int /*j*/)
+                                        { return i == 0; });
+constexpr Bitboard ROW_SECOND = boardMask([](int i, int /*j*/)
+                                         { return i == 1; });
+constexpr Bitboard ROW_LAST = boardMask([](int i, int /*j*/)
+                                       { return i == BOARD_LAST; });
+constexpr Bitboard ROW_BEFORE_LAST = boardMask([](int i, int /*j*/)
+                                              { return i == BOARD_LAST - 1; });
+constexpr Bitboard COL_FIRST = boardMask([](int /*i*/, int j)
+                                        { return j == 0; });
+constexpr Bitboard COL_SECOND = boardMask([](int /*i*/, int j)
+                                         { return j == 1; });
+constexpr Bitboard COL_LAST = boardMask([](int /*i*/, int j)
+                                       { return j == BOARD_LAST; });
+constexpr Bitboard COL_BEFORE_LAST = boardMask([](int /*i*/, int j)
+                                              { return j == BOARD_LAST - 1; });
+
+/**
+ * @brief cells at least range rows and columns away from every border
+ *
+ * @param range
+ * @return Bitboard
+ */
+constexpr Bitboard rangeMask(int range)
+{
+    Bitboard b = {{0, 0}};
+    for (int i = range; i < BOARD_SIZE - range; i++)
+    {
+        for (int j = range; j < BOARD_SIZE - range; j++)
+        {
+            b.set(i * BOARD_SIZE + j);
+        }
+    }
+    return b;
+}
+
+// cells allowed while the opening keeps 0 to 3 rows and columns off the borders
+constexpr Bitboard OPENING_RANGE_MASKS[4] = {rangeMask(0), rangeMask(1), rangeMask(2), rangeMask(3)};
+// cells whose prior is raised by half, rows and columns from the third to the one before last
+constexpr Bitboard PRIOR_CENTER_MASK = boardMask([](int i, int j)
+                                                { return i >= 2 && i <= BOARD_LAST - 1 && j >= 2 && j <= BOARD_LAST - 1; });
+
+/**
+ * @brief move every cell one hex step in a ring direction, cells leaving the board are dropped
+ *
+ * @param b
+ * @param dir index into RING_DX / RING_DY
+ * @return Bitboard
+ */
+inline Bitboard step(Bitboard b, int dir)
+{
+    switch (dir)
+    {
+    case 0:
+        return (b & ~COL_LAST) << 1;
+    case 1:
+        return (b & ~COL_LAST) >> (BOARD_SIZE - 1);
+    case 2:
+        return b >> BOARD_SIZE;
+    case 3:
+        return (b & ~COL_FIRST) >> 1;
+    case 4:
+        return (b & ~COL_FIRST) << (BOARD_SIZE - 1);
+    default:
+        return b << BOARD_SIZE;
+    }
+}
+
+/**
+ * @brief cells adjacent to any cell of b
+ *
+ * @param b
+ * @return Bitboard
+ */
+inline Bitboard neighbors(Bitboard b)
+{
+    return step(b, 0) | step(b, 1) | step(b, 2) | step(b, 3) | step(b, 4) | step(b, 5);
+}
+
+/**
+ * @brief cells of mask connected to seed through cells of mask
+ *
+ * @param seed
+ * @param mask
+ * @return Bitboard
+ */
+inline Bitboard floodFill(Bitboard seed, Bitboard mask)
+{
+    Bitboard reached = seed & mask;
+    while (true)
+    {
+        Bitboard next = (reached | neighbors(reached)) & mask;
+        if (next == reached)
+        {
+            return reached;
+        }
+        reached = next;
+    }
+}
+
+/**
+ * @brief cells bridged to b, both carriers of the bridge in empty.
+ * The bridge between ring directions dir and dir + 1 spans both steps
+ *
+ * @param b
+ * @param empty
+ * @return Bitboard
+ */
+inline Bitboard bridgePartners(Bitboard b, Bitboard empty)
+{
+    Bitboard partners = {{0, 0}};
+    for (int dir = 0; dir < 6; dir++)
+    {
+        int next = (dir + 1) % 6;
+        Bitboard sources = b & step(empty, (dir + 3) % 6) & step(empty, (next + 3) % 6);
+        partners = partners | step(step(sources, dir), next);
+    }
+    return partners;
+}
+
+/**
+ * @brief b mirrored on the main diagonal, cell (x, y) moves to (y, x)
+ *
+ * @param b
+ * @return Bitboard
+ */
+inline Bitboard transposed(Bitboard b)
+{
+    Bitboard result = {{0, 0}};
+    for (int idx = b.lowest(); idx >= 0; idx = b.lowest())
+    {
+        b.reset(idx);
+        result.set(idx % BOARD_SIZE * BOARD_SIZE + idx / BOARD_SIZE);
+    }
+    return result;
+}
+
+/**
+ * @brief count the cells of b in the 3x3 square around every cell, clipped to the board:
+ * the square is the cell, its 6 neighbors and the 2 cells diagonal to it off the hex ring
+ *
+ * @param b
+ * @return std::array<Bitboard, 4> entry k holds the cells with at least k + 1 cells of b
+ */
+inline std::array<Bitboard, 4> squareCounts(Bitboard b)
+{
+    Bitboard shifted[9] = {b, step(b, 0), step(b, 1), step(b, 2), step(b, 3), step(b, 4), step(b, 5),
+                           step(step(b, 2), 3), step(step(b, 5), 0)};
+    std::array<Bitboard, 4> atLeast = {};
+    for (auto &cells : shifted)
+    {
+        // saturating unary counter, one bitboard per count
+        for (int k = 3; k > 0; k--)
+        {
+            atLeast[k] = atLeast[k] | (atLeast[k - 1] & cells);
+        }
+        atLeast[0] = atLeast[0] | cells;
+    }
+    return atLeast;
+}
+
+// games rolled out side by side, one per SIMD lane of 64 bit words
+const int ROLLOUT_LANES = 4;
+typedef uint64_t LaneWords __attribute__((vector_size(ROLLOUT_LANES * 8)));
+
+/**
+ * @brief ROLLOUT_LANES bitboards, word i of every board in the lanes of w[i]
+ *
+ */
+struct LaneBoards
+{
+    LaneWords w[BOARD_WORDS];
+
+    /**
+     * @brief the same board in every lane
+     *
+     */
+    static LaneBoards broadcast(const Bitboard &b)
+    {
+        LaneBoards lanes;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            lanes.w[i] = LaneWords{} + b.w[i];
+        }
+        return lanes;
+    }
+
+    LaneBoards operator|(const LaneBoards &rhs) const
+    {
+        LaneBoards lanes;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            lanes.w[i] = w[i] | rhs.w[i];
+        }
+        return lanes;
+    }
+
+    LaneBoards operator&(const LaneBoards &rhs) const
+    {
+        LaneBoards lanes;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            lanes.w[i] = w[i] & rhs.w[i];
+        }
+        return lanes;
+    }
+
+    LaneBoards operator&(const Bitboard &rhs) const
+    {
+        LaneBoards lanes;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            lanes.w[i] = w[i] & rhs.w[i];
+        }
+        return lanes;
+    }
+
+    LaneBoards operator<<(int n) const
+    {
+        LaneBoards lanes;
+        for (int i = BOARD_WORDS - 1; i > 0; i--)
+        {
+            lanes.w[i] = (w[i] << n) | (w[i - 1] >> (64 - n));
+        }
+        lanes.w[0] = w[0] << n;
+        lanes.w[BOARD_WORDS - 1] &= LAST_WORD_MASK;
+        return lanes;
+    }
+
+    LaneBoards operator>>(int n) const
+    {
+        LaneBoards lanes;
+        for (int i = 0; i < BOARD_WORDS - 1; i++)
+        {
+            lanes.w[i] = (w[i] >> n) | (w[i + 1] << (64 - n));
+        }
+        lanes.w[BOARD_WORDS - 1] = w[BOARD_WORDS - 1] >> n;
+        return lanes;
+    }
+
+    /**
+     * @brief if the board of a lane has any cell
+     *
+     */
+    bool any(int lane) const
+    {
+        uint64_t bits = 0;
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            bits |= w[i][lane];
+        }
+        return bits != 0;
+    }
+};
+
+/**
+ * @brief neighbors of every board of the lanes, as neighbors() does for one
+ *
+ * @param b
+ * @return LaneBoards
+ */
+inline LaneBoards laneNeighbors(const LaneBoards &b)
+{
+    LaneBoards notLast = b & ~COL_LAST;
+    LaneBoards notFirst = b & ~COL_FIRST;
+    return (notLast << 1) | (notLast >> (BOARD_SIZE - 1)) | (b >> BOARD_SIZE) | (notFirst >> 1) | (notFirst << (BOARD_SIZE - 1)) | (b << BOARD_SIZE);
+}
+
+/**
+ * @brief cells of mask connected to seed, for every board of the lanes, until all lanes settle
+ *
+ * @param seed
+ * @param mask
+ * @return LaneBoards
+ */
+inline LaneBoards laneFloodFill(const LaneBoards &seed, const LaneBoards &mask)
+{
+    LaneBoards reached = seed & mask;
+    while (true)
+    {
+        LaneBoards next = (reached | laneNeighbors(reached)) & mask;
+        LaneWords changed = LaneWords{};
+        for (int i = 0; i < BOARD_WORDS; i++)
+        {
+            changed |= next.w[i] ^ reached.w[i];
+        }
+        reached = next;
+        bool settled = true;
+        for (int lane = 0; lane < ROLLOUT_LANES; lane++)
+        {
+            settled = settled && changed[lane] == 0;
+        }
+        if (settled)
+        {
+            return reached;
+        }
+    }
+}
+
+/**
+ * @brief xorshift64* step
+ *
+ * @param state
+ * @return uint64_t
+ */
+inline uint64_t nextRandom(uint64_t &state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief uniformly random rollouts to the end of the game, ROLLOUT_LANES at a time.
+ * Random play fills the board, so each game is a random split of the empty cells in
+ * the numbers of stones each side has left, the winner is found on the full boards
+ *
+ * @param state position to roll out
+ * @param games number of rollouts
+ * @param random xorshift state
+ * @return int games won by red
+ */
+int randomRollouts(GameState &state, int games, uint64_t &random)
+{
+    Bitboard red = state.getStones(true);
+    Bitboard empty = state.emptyCells();
+    int cells[BOARD_CELLS];
+    int emptyCount = 0;
+    for (Bitboard rest = empty; rest.any();)
+    {
+        cells[emptyCount] = rest.lowest();
+        rest.reset(cells[emptyCount++]);
+    }
+    int redMoves = state.redPlaysNext() ? (emptyCount + 1) / 2 : emptyCount / 2;
+    int redWins = 0;
+    for (int first = 0; first < games; first += ROLLOUT_LANES)
+    {
+        LaneBoards redBoards = LaneBoards::broadcast(red);
+        for (int lane = 0; lane < ROLLOUT_LANES; lane++)
+        {
+            // partial Fisher-Yates, the first redMoves cells drawn go to red
+            for (int i = 0; i < redMoves; i++)
+            {
+                // multiply and shift instead of a division to draw below emptyCount - i
+                int j = i + (int)(((nextRandom(random) >> 32) * (emptyCount - i)) >> 32);
+                std::swap(cells[i], cells[j]);
+                redBoards.w[cells[i] >> 6][lane] |= 1ULL << (cells[i] & 63);
+            }
+        }
+        // on a full board exactly one side connects, red's connection decides
+        LaneBoards crossing = laneFloodFill(redBoards & ROW_FIRST, redBoards) & ROW_LAST;
+        for (int lane = 0; lane < ROLLOUT_LANES && first + lane < games; lane++)
+        {
+            redWins += crossing.any(lane);
+        }
+    }
+    return redWins;
+}
+
+time_t getTimeInMilis()
+{
+    // monotonic, not affected by wall clock adjustments
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SearchClock::SearchClock() : _ticksPerMs(0), _baseTicks(0), _baseMs(getTimeInMilis())
+{
+#if defined(__x86_64__) || defined(__i386__)
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTicks = __rdtsc();
+    auto end = start;
+    while (end - start < std::chrono::milliseconds(2))
+    {
+        end = std::chrono::steady_clock::now();
+    }
+    uint64_t endTicks = __rdtsc();
+    _ticksPerMs = (endTicks - startTicks) / std::chrono::duration<double, std::milli>(end - start).count();
+    _baseTicks = endTicks;
+    _baseMs = std::chrono::duration<double, std::milli>(end.time_since_epoch()).count();
+#endif
+}
+
+double SearchClock::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return _baseMs + (__rdtsc() - _baseTicks) / _ticksPerMs;
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+#endif
+}
+
+void SearchClock::rebase()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks = __rdtsc();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    // a window of a turn or more makes preemption between the two reads negligible
+    if (ms - _baseMs >= 100)
+    {
+        _ticksPerMs = (ticks - _baseTicks) / (ms - _baseMs);
+    }
+    _baseTicks = ticks;
+    _baseMs = ms;
+#endif
+}
+
+/**
+ * @brief the process wide search clock, calibrated on first use
+ *
+ * @return SearchClock&
+ */
+SearchClock &searchClock()
+{
+    static SearchClock clock;
+    return clock;
+}
+
+time_t getCpuTimeInMilis()
+{
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+//*************************End of Helper Functions
+
+// Member function Impl
+GameState::GameState() : board{}, totalPieces(0), filledPieces(0), stones{}, zobristKey(0), rotatedKey(0), neighborCodes(BORDER_CODES), history(), groupParent(), groupEdges(), connectedSides(0)
+{
+}
+
+int GameState::findGroup(int cell)
+{
+    while (groupParent[cell] != cell)
+    {
+        groupParent[cell] = groupParent[groupParent[cell]];
+        cell = groupParent[cell];
+    }
+    return cell;
+}
+
+void GameState::joinGroups(int x, int y, bool isRed)
+{
+    int cell = x * BOARD_SIZE + y;
+    const CellTopology &topology = TOPOLOGY[cell];
+    const unsigned char *edgeDistance = topology.edgeDistance + (isRed ? 0 : 2);
+    groupParent[cell] = cell;
+    groupEdges[cell] = (edgeDistance[0] == 0 ? 1 : 0) | (edgeDistance[1] == 0 ? 2 : 0);
+    const Bitboard &mine = stones[isRed ? 0 : 1];
+    for (int i = 0; i < topology.neighborCount; i++)
+    {
+        int next = topology.neighbors[i];
+        if (mine.test(next))
+        {
+            int root = findGroup(next);
+            if (root != cell)
+            {
+                groupParent[root] = cell;
+                groupEdges[cell] |= groupEdges[root];
+            }
+        }
+    }
+    if (groupEdges[cell] == 3)
+    {
+        connectedSides |= isRed ? 1 : 2;
+    }
+}
+
+int GameState::edgesAfter(int cell, bool isRed)
+{
+    const CellTopology &topology = TOPOLOGY[cell];
+    const unsigned char *edgeDistance = topology.edgeDistance + (isRed ? 0 : 2);
+    int edges = (edgeDistance[0] == 0 ? 1 : 0) | (edgeDistance[1] == 0 ? 2 : 0);
+    const Bitboard &mine = stones[isRed ? 0 : 1];
+    for (int i = 0; i < topology.neighborCount; i++)
+    {
+        int next = topology.neighbors[i];
+        if (mine.test(next))
+        {
+            edges |= groupEdges[findGroup(next)];
+        }
+    }
+    return edges;
+}
+
+void GameState::updateNeighborCodes(int x, int y, int value)
+{
+    int cell = x * BOARD_SIZE + y;
+    const CellTopology &topology = TOPOLOGY[cell];
+    for (int i = 0; i < 6; i++)
+    {
+        int next = topology.ring[i];
+        if (next != cell)
+        {
+            // the new stone is the opposite ring neighbor of the cell next to it
+            neighborCodes[next] = withNeighbor(neighborCodes[next], (i + 3) % 6, value);
+        }
+    }
+}
+
+bool GameState::boardIsFull()
+{
+    return totalPieces + filledPieces == BOARD_CELLS;
+}
+
+void GameState::recoverState()
+{
+    // 读入JSON
+    std::string str;
+    getline(std::cin, str);
+    Json::Reader reader;
+    Json::Value input;
+    reader.parse(str, input);
+    // 分析自己收到的输入和自己过往的输出，并恢复状态
+    int turnID = input["responses"].size();
+    for (int i = 0; i < turnID; i++)
+    {
+        plays({input["requests"][i]["x"].asInt(), input["requests"][i]["y"].asInt()});
+        plays({input["responses"][i]["x"].asInt(), input["responses"][i]["y"].asInt()});
+    }
+    plays({input["requests"][turnID]["x"].asInt(), input["requests"][turnID]["y"].asInt()});
+}
+
+bool GameState::redPlaysNext()
+{
+    return totalPieces % 2 == 0;
+}
+
+bool GameState::redPlayedLast()
+{
+    return !redPlaysNext();
+}
+
+int GameState::getTotalPieces()
+{
+    return totalPieces;
+}
+
+int GameState::moveAt(int ply)
+{
+    return ply >= 0 && ply < totalPieces && history[ply] != NO_MOVE ? history[ply] : -1;
+}
+
+uint64_t GameState::getZobristKey()
+{
+    return zobristKey;
+}
+
+uint64_t GameState::getCanonicalKey()
+{
+    return std::min(zobristKey, rotatedKey);
+}
+
+uint64_t GameState::canonicalKeyAfter(action2D action)
+{
+    bool isRed = redPlaysNext();
+    return std::min(zobristKey ^ zobristFor(action, isRed), rotatedKey ^ zobristFor(rotate(action), isRed));
+}
+
+bool GameState::canonicalIsRotated()
+{
+    return rotatedKey < zobristKey;
+}
+
+action2D GameState::rotate(action2D action)
+{
+    return {BOARD_LAST - action.actionX, BOARD_LAST - action.actionY};
+}
+
+int GameState::neighborhoodCode(int x, int y)
+{
+    return neighborCodes[x * BOARD_SIZE + y];
+}
+
+void GameState::classifyInferior(signed char inferior[][BOARD_SIZE], bool withDominated)
+{
+    int codes[BOARD_SIZE][BOARD_SIZE];
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            inferior[i][j] = 0;
+            if (board[i][j] == 0)
+            {
+                codes[i][j] = neighborhoodCode(i, j);
+                if (isDeadCode(codes[i][j]))
+                {
+                    inferior[i][j] = INFERIOR_DEAD;
+                }
+            }
+        }
+    }
+    // captured pairs: if the opponent takes one cell, the other makes it dead.
+    // stones only make cells more dead, so disjoint pairs can all be filled
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            if (board[i][j] != 0 || inferior[i][j] != 0)
+            {
+                continue;
+            }
+            int cell = i * BOARD_SIZE + j;
+            const CellTopology &topology = TOPOLOGY[cell];
+            for (int n = 0; n < 6 && inferior[i][j] == 0; n++)
+            {
+                int next = topology.ring[n];
+                int ni = next / BOARD_SIZE, nj = next % BOARD_SIZE;
+                if (next == cell || board[ni][nj] != 0 || inferior[ni][nj] != 0)
+                {
+                    continue;
+                }
+                for (int color = 1; color <= 2; color++)
+                {
+                    if (isDeadCode(withNeighbor(codes[i][j], n, color)) && isDeadCode(withNeighbor(codes[ni][nj], (n + 3) % 6, color)))
+                    {
+                        inferior[i][j] = inferior[ni][nj] = color == 1 ? INFERIOR_CAPTURED_RED : INFERIOR_CAPTURED_BLACK;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    if (!withDominated)
+    {
+        return;
+    }
+    // a stone at k that kills c is at least as good as a stone at c, keep k
+    int mover = redPlaysNext() ? 1 : 2;
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            if (board[i][j] != 0 || inferior[i][j] != 0)
+            {
+                continue;
+            }
+            int cell = i * BOARD_SIZE + j;
+            const CellTopology &topology = TOPOLOGY[cell];
+            for (int n = 0; n < 6; n++)
+            {
+                int next = topology.ring[n];
+                int ni = next / BOARD_SIZE, nj = next % BOARD_SIZE;
+                if (next == cell || board[ni][nj] != 0 || inferior[ni][nj] != 0)
+                {
+                    continue;
+                }
+                if (isDeadCode(withNeighbor(codes[i][j], n, mover)))
+                {
+                    inferior[i][j] = INFERIOR_DOMINATED;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int GameState::fillInferiorCells()
+{
+    signed char inferior[BOARD_SIZE][BOARD_SIZE];
+    classifyInferior(inferior, false);
+    int filled = 0;
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            if (inferior[i][j] == 0)
+            {
+                continue;
+            }
+            // color of a dead cell does not matter
+            bool isRed = inferior[i][j] != INFERIOR_CAPTURED_BLACK;
+            board[i][j] = isRed ? 1 : -1;
+            stones[isRed ? 0 : 1].set(i * BOARD_SIZE + j);
+            updateNeighborCodes(i, j, isRed ? 1 : 2);
+            joinGroups(i, j, isRed);
+            zobristKey ^= zobristFor({i, j}, isRed);
+            rotatedKey ^= zobristFor(rotate({i, j}), isRed);
+            filled++;
+        }
+    }
+    filledPieces += filled;
+    return filled;
+}
+
+Bitboard GameState::getStones(bool isRed)
+{
+    return stones[isRed ? 0 : 1];
+}
+
+Bitboard GameState::emptyCells()
+{
+    return ~(stones[0] | stones[1]);
+}
+
+Bitboard GameState::winningCells(bool isRed)
+{
+    Bitboard cells = {{0, 0}};
+    // a cell away from own stones reaches one edge at most
+    Bitboard candidates = neighbors(stones[isRed ? 0 : 1]) & emptyCells();
+    for (int cell = candidates.lowest(); cell >= 0; cell = candidates.lowest())
+    {
+        candidates.reset(cell);
+        if (edgesAfter(cell, isRed) == 3)
+        {
+            cells.set(cell);
+        }
+    }
+    return cells;
+}
+
+int GameState::decisiveCell(bool isRed)
+{
+    Bitboard candidates = neighbors(stones[isRed ? 0 : 1]) & emptyCells();
+    for (int cell = candidates.lowest(); cell >= 0; cell = candidates.lowest())
+    {
+        candidates.reset(cell);
+        if (edgesAfter(cell, isRed) == 3)
+        {
+            return cell;
+        }
+    }
+    return -1;
+}
+
+int GameState::forcedCell()
+{
+    bool isRed = redPlaysNext();
+    int cell = decisiveCell(isRed);
+    return cell >= 0 ? cell : decisiveCell(!isRed);
+}
+
+/**
+ * @brief stones of the second row whose two carriers on the edge row are empty
+ *
+ * @param mine
+ * @param empty
+ * @param templateRow row or column next to the edge
+ * @param dirA ring direction of the first carrier
+ * @param dirB ring direction of the second carrier
+ * @return Bitboard
+ */
+inline Bitboard edgeBridged(Bitboard mine, Bitboard empty, Bitboard templateRow, int dirA, int dirB)
+{
+    return mine & templateRow & step(empty, (dirA + 3) % 6) & step(empty, (dirB + 3) % 6);
+}
+
+bool GameState::virtualWinAfter(bool isRed, int cell, Bitboard &carrier)
+{
+    Bitboard mine = stones[isRed ? 0 : 1];
+    Bitboard empty = emptyCells();
+    if (cell >= 0)
+    {
+        mine.set(cell);
+        empty.reset(cell);
+    }
+    // ring directions of the edge bridge carriers at the start and end edge
+    int startA = isRed ? 2 : 3, startB = isRed ? 1 : 4;
+    int endA = isRed ? 5 : 0, endB = isRed ? 4 : 1;
+    Bitboard startTemplate = isRed ? ROW_SECOND : COL_SECOND;
+    Bitboard endTemplate = isRed ? ROW_BEFORE_LAST : COL_BEFORE_LAST;
+    Bitboard end = isRed ? ROW_LAST : COL_LAST;
+
+    carrier = Bitboard{{0, 0}};
+    Bitboard reached = mine & (isRed ? ROW_FIRST : COL_FIRST);
+    Bitboard bridged = edgeBridged(mine, empty, startTemplate, startA, startB);
+    for (int s = bridged.lowest(); s >= 0; s = bridged.lowest())
+    {
+        bridged.reset(s);
+        Bitboard carriers = step(Bitboard::single(s), startA) | step(Bitboard::single(s), startB);
+        if (!(carriers & carrier).any())
+        {
+            carrier = carrier | carriers;
+            reached.set(s);
+        }
+    }
+    reached = floodFill(reached, mine);
+    // grow through bridges one at a time, carriers of different bridges stay disjoint
+    while (true)
+    {
+        Bitboard free = empty & ~carrier;
+        Bitboard partners = bridgePartners(reached, free) & mine & ~reached;
+        int p = partners.lowest();
+        if (p < 0)
+        {
+            break;
+        }
+        const CellTopology &topology = TOPOLOGY[p];
+        for (int i = 0; i < topology.bridgeCount; i++)
+        {
+            if (!reached.test(topology.bridges[i]))
+            {
+                continue;
+            }
+            Bitboard carriers = Bitboard::single(topology.carriers[i][0]) | Bitboard::single(topology.carriers[i][1]);
+            if ((carriers & free) == carriers)
+            {
+                carrier = carrier | carriers;
+                reached = floodFill(reached | Bitboard::single(p), mine);
+                break;
+            }
+        }
+    }
+    if ((reached & end).any())
+    {
+        return true;
+    }
+    Bitboard endBridged = edgeBridged(reached, empty & ~carrier, endTemplate, endA, endB);
+    if (endBridged.any())
+    {
+        int s = endBridged.lowest();
+        carrier = carrier | step(Bitboard::single(s), endA) | step(Bitboard::single(s), endB);
+        return true;
+    }
+    return false;
+}
+
+bool GameState::mustPlayRegion(Bitboard &region)
+{
+    bool moverRed = redPlaysNext();
+    region = winningCells(moverRed);
+    if (region.any())
+    {
+        return true;
+    }
+    region = winningCells(!moverRed);
+    if (region.any())
+    {
+        // more than one cell means the game is lost, blocking one is all there is
+        return true;
+    }
+    Bitboard carrier;
+    if (virtualWinAfter(!moverRed, -1, carrier))
+    {
+        // already connected whatever happens, every move loses
+        region = Bitboard{{0, 0}};
+        return false;
+    }
+
+    // candidates link the opponent's virtual reach from both edges
+    bool isRed = !moverRed;
+    Bitboard opp = stones[isRed ? 0 : 1];
+    Bitboard empty = emptyCells();
+    Bitboard startEdge = isRed ? ROW_FIRST : COL_FIRST, endEdge = isRed ? ROW_LAST : COL_LAST;
+    Bitboard startTemplate = edgeBridged(empty, empty, isRed ? ROW_SECOND : COL_SECOND, isRed ? 2 : 3, isRed ? 1 : 4);
+    Bitboard endTemplate = edgeBridged(empty, empty, isRed ? ROW_BEFORE_LAST : COL_BEFORE_LAST, isRed ? 5 : 0, isRed ? 4 : 1);
+    Bitboard fromStart = opp & (startEdge | edgeBridged(opp, empty, isRed ? ROW_SECOND : COL_SECOND, isRed ? 2 : 3, isRed ? 1 : 4));
+    Bitboard fromEnd = opp & (endEdge | edgeBridged(opp, empty, isRed ? ROW_BEFORE_LAST : COL_BEFORE_LAST, isRed ? 5 : 0, isRed ? 4 : 1));
+    for (Bitboard *reach : {&fromStart, &fromEnd})
+    {
+        while (true)
+        {
+            Bitboard next = floodFill(*reach | (bridgePartners(*reach, empty) & opp), opp);
+            if (next == *reach)
+            {
+                break;
+            }
+            *reach = next;
+        }
+    }
+    Bitboard candidates = empty & (neighbors(fromStart) | bridgePartners(fromStart, empty) | startEdge | startTemplate) &
+                          (neighbors(fromEnd) | bridgePartners(fromEnd, empty) | endEdge | endTemplate);
+
+    // every threat has to be stopped, only cells in all their carriers do
+    region = ~Bitboard{{0, 0}};
+    bool threatened = false;
+    for (int c = candidates.lowest(); c >= 0; c = candidates.lowest())
+    {
+        candidates.reset(c);
+        if (virtualWinAfter(isRed, c, carrier))
+        {
+            region = region & (carrier | Bitboard::single(c));
+            threatened = true;
+        }
+    }
+    region = threatened ? region & empty : Bitboard{{0, 0}};
+    return region.any();
+}
+
+void GameState::edgeDistances(bool isRed, bool fromLast, std::array<cell_t, BOARD_CELLS> &distance)
+{
+    distance.fill(UNREACHED);
+    Bitboard own = stones[isRed ? 0 : 1];
+    Bitboard empty = emptyCells();
+    Bitboard edge = isRed ? (fromLast ? ROW_LAST : ROW_FIRST) : (fromLast ? COL_LAST : COL_FIRST);
+    // own groups on the edge are part of it, cells next to the edge or to them are at 1
+    Bitboard reachedOwn = floodFill(edge & own, own);
+    Bitboard frontier = (edge | neighbors(reachedOwn)) & empty;
+    Bitboard reached = frontier;
+    for (int level = 1; frontier.any(); level++)
+    {
+        for (Bitboard cells = frontier; cells.any();)
+        {
+            int idx = cells.lowest();
+            cells.reset(idx);
+            distance[idx] = level;
+        }
+        reachedOwn = floodFill(reachedOwn | (neighbors(frontier) & own), own);
+        // count reached neighbors up to two, all reached own stones count as one neighbor
+        Bitboard ones = neighbors(reachedOwn);
+        Bitboard twos = {{0, 0}};
+        for (int dir = 0; dir < 6; dir++)
+        {
+            Bitboard shifted = step(reached, dir);
+            twos = twos | (ones & shifted);
+            ones = ones | shifted;
+        }
+        frontier = twos & empty & ~reached;
+        reached = reached | frontier;
+    }
+}
+
+int GameState::potential(bool isRed)
+{
+    if (oneSideTest(isRed))
+    {
+        return 0;
+    }
+    std::array<cell_t, BOARD_CELLS> first, last;
+    edgeDistances(isRed, false, first);
+    edgeDistances(isRed, true, last);
+    int best = UNREACHED;
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
+    {
+        best = std::min(best, first[idx] + last[idx]);
+    }
+    return best;
+}
+
+float GameState::evaluate()
+{
+    int red = potential(true);
+    int black = potential(false);
+    // a potential is lowered by about one per own move
+    float lead = black - red + (redPlaysNext() ? 0.5f : -0.5f);
+    return tanh(lead / 4.0f);
+}
+
+void GameState::legalCells(CellBuffer &cells)
+{
+    cells.clear();
+    Bitboard empty = emptyCells();
+    for (int idx = empty.lowest(); idx >= 0; idx = empty.lowest())
+    {
+        empty.reset(idx);
+        cells.push_back({(cell_t)idx});
+    }
+}
+
+std::vector<action2D> GameState::legalActions()
+{
+    CellBuffer cells;
+    legalCells(cells);
+    std::vector<action2D> actions;
+    for (auto cell : cells)
+    {
+        actions.push_back(cell.action());
+    }
+    return actions;
+}
+
+bool GameState::plays(int action)
+{
+    if (action >= 0 and action < BOARD_CELLS)
+    {
+        int actionX = action / BOARD_SIZE;
+        int actionY = action % BOARD_SIZE;
+        action2D a2d = {actionX, actionY};
+        return GameState::plays(a2d);
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool GameState::plays(action2D action)
+{
+    if (action.actionX >= 0 && action.actionX < BOARD_SIZE && action.actionY >= 0 && action.actionY < BOARD_SIZE)
+    {
+        board[action.actionX][action.actionY] = (totalPieces % 2 == 0) ? 1 : -1;
+        stones[totalPieces % 2].set(action.actionX * BOARD_SIZE + action.actionY);
+        updateNeighborCodes(action.actionX, action.actionY, totalPieces % 2 + 1);
+        joinGroups(action.actionX, action.actionY, totalPieces % 2 == 0);
+        history[totalPieces] = action.actionX * BOARD_SIZE + action.actionY;
+        zobristKey ^= zobristFor(action, totalPieces % 2 == 0);
+        rotatedKey ^= zobristFor(rotate(action), totalPieces % 2 == 0);
+        totalPieces += 1;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool GameState::oneSideTest(bool isRed)
+{
+    return connectedSides & (isRed ? 1 : 2);
+}
+
+bool GameState::lastPlayerWon()
+{
+    bool isRed = redPlayedLast();
+    return oneSideTest(isRed);
+}
+
+int GameState::checkTermination()
+{
+    if (oneSideTest(true))
+    {
+        return 1;
+    }
+    else if (oneSideTest(false))
+    {
+        return -1;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+void GameState::setState(signed char b[][BOARD_SIZE])
+{
+    int counter = 0;
+    zobristKey = 0;
+    rotatedKey = 0;
+    stones[0] = stones[1] = Bitboard{{0, 0}};
+    neighborCodes = BORDER_CODES;
+    connectedSides = 0;
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        for (int j = 0; j < BOARD_SIZE; j++)
+        {
+            board[i][j] = b[i][j];
+            if (b[i][j] != 0)
+            {
+                counter++;
+                stones[b[i][j] == 1 ? 0 : 1].set(i * BOARD_SIZE + j);
+                updateNeighborCodes(i, j, b[i][j] == 1 ? 1 : 2);
+                joinGroups(i, j, b[i][j] == 1);
+                zobristKey ^= zobristFor({i, j}, b[i][j] == 1);
+                rotatedKey ^= zobristFor(rotate({i, j}), b[i][j] == 1);
+            }
+        }
+    }
+    totalPieces = counter;
+    filledPieces = 0;
+    // the order of the moves is unknown
+    history.fill(NO_MOVE);
+}
+
+void GameState::printBoard()
+{
+    for (int i = 0; i < BOARD_SIZE; i++)
+    {
+        std::cout << std::string(i * 2, ' ');
+        for (auto v : board[i])
+        {
+            std::cout.width(3);
+            std::cout << (short)v;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void GameState::generateMoves(MoveBuffer &moves, bool forcedFirst, action2D forcedPlay, bool openingRange)
+{
+    moves.clear();
+    if (totalPieces == 0 && forcedFirst)
+    {
+        moves.push_back({{(cell_t)(forcedPlay.actionX * BOARD_SIZE + forcedPlay.actionY)}, 1.0});
+        return;
+    }
+    // force ignore border bound for first 10 moves,
+    // force ignore border 2 rows for first 4 moves
+    int range = !openingRange ? 0 : (totalPieces <= 4 ? 3 : (totalPieces <= 8 ? 2 : (totalPieces <= 12 ? 1 : 0)));
+    Bitboard inRange = emptyCells() & OPENING_RANGE_MASKS[range];
+    // dead, captured and dominated cells are never expanded
+    signed char inferior[BOARD_SIZE][BOARD_SIZE];
+    classifyInferior(inferior);
+    Bitboard actions = inRange;
+    for (Bitboard cells = inRange; cells.any();)
+    {
+        int idx = cells.lowest();
+        cells.reset(idx);
+        if (inferior[idx / BOARD_SIZE][idx % BOARD_SIZE] != 0)
+        {
+            actions.reset(idx);
+        }
+    }
+    if (!actions.any())
+    {
+        actions = inRange;
+    }
+
+    // stones around each cell, the 3x3 window is read at the transposed cell as the
+    // window loop always did, the bounds of x select the row of the board
+    std::array<Bitboard, 4> red = squareCounts(transposed(stones[0]));
+    std::array<Bitboard, 4> black = squareCounts(transposed(stones[1]));
+    std::array<Bitboard, 4> all = squareCounts(transposed(stones[0] | stones[1]));
+    // both colors around, one of them at least twice
+    Bitboard contested = (red[0] & black[1]) | (red[1] & black[0]);
+    Bitboard crowded = all[3];
+    for (int idx = actions.lowest(); idx >= 0; idx = actions.lowest())
+    {
+        actions.reset(idx);
+        float heuristicMultiplier = 1.0;
+        if (contested.test(idx))
+        {
+            heuristicMultiplier *= 2;
+        }
+        if (crowded.test(idx))
+        {
+            heuristicMultiplier *= 2;
+        }
+        if (PRIOR_CENTER_MASK.test(idx))
+        {
+            heuristicMultiplier *= 1.5;
+        }
+        moves.push_back({{(cell_t)idx}, heuristicMultiplier});
+    }
+}
+
+void OriginalPrior::apply(GameState &state, MoveBuffer &moves, ResistanceEvaluator & /*resistance*/)
+{
+    Bitboard red = state.getStones(true);
+    Bitboard black = state.getStones(false);
+    for (auto &move : moves)
+    {
+        action2D action = move.cell.action();
+        float heuristicMultiplier = 1.0;
+        // the windows keep their old bounds: x bounds the columns, y the rows, and the
+        // corners cut to a hexagon are chosen by mixing both
+        // with in range 2, there is a piece, multiplier*1.1
+        int l = std::max(0, action.actionX - 2), r = std::min(BOARD_LAST, action.actionX + 2);
+        int u = std::max(0, action.actionY - 2), b = std::min(BOARD_LAST, action.actionY + 2);
+        int minBound = 0, maxBound = 0;
+        if (action.actionX - u == 2 && action.actionY - l == 2)
+            minBound = 2;
+        else if (action.actionX - u >= 1 && action.actionY - l == 1)
+            minBound = 1;
+        if (b - action.actionX == 2 && r - action.actionY == 2)
+            maxBound = -2;
+        else if (b - action.actionX >= 1 && r - action.actionY == 1)
+            maxBound = -1;
+        bool nearby = false;
+        for (int i = u; i < b + 1 && !nearby; i++)
+        {
+            for (int j = l; j < r + 1 && !nearby; j++)
+            {
+                if (i - u < minBound && j - l < minBound - i + u)
+                {
+                    continue;
+                }
+                if (i - b - 1 > maxBound && j - r > maxBound - i + b)
+                {
+                    continue;
+                }
+                nearby = red.test(i * BOARD_SIZE + j) || black.test(i * BOARD_SIZE + j);
+            }
+        }
+        if (nearby)
+        {
+            heuristicMultiplier *= 1.1;
+        }
+        // bridge pattern multiplier*1.25
+        int l1 = std::max(0, action.actionX - 1), r1 = std::min(BOARD_LAST, action.actionX + 1);
+        int u1 = std::max(0, action.actionY - 1), b1 = std::min(BOARD_LAST, action.actionY + 1);
+        minBound = action.actionX - u1 >= 1 && action.actionY - l1 == 1 ? 1 : 0;
+        maxBound = b1 - action.actionX >= 1 && r1 - action.actionY == 1 ? -1 : 0;
+        int redPiece = 0, blackPiece = 0;
+        for (int i = u1; i < b1 + 1; i++)
+        {
+            for (int j = l1; j < r1 + 1; j++)
+            {
+                if (i - u1 < minBound && j - l1 < minBound - i + u1)
+                {
+                    continue;
+                }
+                if (i - b1 - 1 > maxBound && j - r1 > maxBound - i + b1)
+                {
+                    continue;
+                }
+                redPiece += red.test(i * BOARD_SIZE + j);
+                blackPiece += black.test(i * BOARD_SIZE + j);
+            }
+        }
+        if ((redPiece >= 1 && blackPiece > 1) || (redPiece > 1 && blackPiece >= 1))
+        {
+            heuristicMultiplier *= 1.25;
+        }
+        // if close to border, multiplier*0.8
+        if (u1 * r1 == 0 || b1 == BOARD_LAST || l1 == BOARD_LAST)
+        {
+            heuristicMultiplier *= 0.8;
+        }
+        move.probability = heuristicMultiplier;
+    }
+}
+
+void RavePrior::apply(GameState &state, MoveBuffer &moves, ResistanceEvaluator & /*resistance*/)
+{
+    // stones in the square windows around each cell, read at the transposed cell as the
+    // window loops always did, range 2 is the range 1 window grown once more
+    Bitboard redStones = state.getStones(true), blackStones = state.getStones(false);
+    std::array<Bitboard, 4> red = squareCounts(transposed(redStones));
+    std::array<Bitboard, 4> black = squareCounts(transposed(blackStones));
+    std::array<Bitboard, 4> all = squareCounts(transposed(redStones | blackStones));
+    Bitboard nearby = squareCounts(all[0])[0];
+    Bitboard contested = red[0] & black[0];
+    Bitboard crowded = contested & all[2];
+    for (auto &move : moves)
+    {
+        int idx = move.cell.value;
+        float heuristicMultiplier = 1.0;
+        if (nearby.test(idx))
+        {
+            heuristicMultiplier *= 1.5;
+        }
+        if (contested.test(idx))
+        {
+            heuristicMultiplier *= 1.5;
+        }
+        if (crowded.test(idx))
+        {
+            heuristicMultiplier *= 2;
+        }
+        move.probability = heuristicMultiplier;
+    }
+}
+
+std::vector<ActionPrior> GameState::outputActionPrior(bool forcedFirst, action2D forcedPlay)
+{
+    MoveBuffer moves;
+    generateMoves(moves, forcedFirst, forcedPlay);
+    std::vector<ActionPrior> apPairs;
+    for (auto &move : moves)
+    {
+        apPairs.push_back({move.cell.action(), move.probability});
+    }
+    return apPairs;
+}
+
+action2D GameState::rolloutAction(int half)
+{
+    int lastMove = moveAt(totalPieces - 1);
+    if (lastMove >= 0 && half != 2)
+    {
+        int reply = (BRIDGE_REPLY_TABLE[neighborCodes[lastMove]] >> (redPlaysNext() ? 0 : 4)) & 15;
+        if (reply != 0)
+        {
+            int cell = TOPOLOGY[lastMove].ring[reply - 1];
+            return {cell / BOARD_SIZE, cell % BOARD_SIZE};
+        }
+    }
+    // same opening range as outputActionPrior
+    int range = totalPieces <= 4 ? 3 : (totalPieces <= 8 ? 2 : (totalPieces <= 12 ? 1 : 0));
+    int candidates = 0;
+    for (int i = range; i < BOARD_SIZE - range; i++)
+    {
+        for (int j = range; j < BOARD_SIZE - range; j++)
+        {
+            candidates += board[i][j] == 0;
+        }
+    }
+    int first = half == 2 ? candidates / 2 : 0;
+    int last = half == 1 && candidates > 1 ? candidates / 2 : candidates;
+    int index = 0;
+    int best = -1;
+    float bestWeight = 0;
+    for (int i = range; i < BOARD_SIZE - range; i++)
+    {
+        for (int j = range; j < BOARD_SIZE - range; j++)
+        {
+            if (board[i][j] != 0)
+            {
+                continue;
+            }
+            if (index >= first && index < last)
+            {
+                int cell = i * BOARD_SIZE + j;
+                float weight = PATTERN_WEIGHTS[neighborCodes[cell] & ~BORDER_MASKS[cell]] * CELL_WEIGHTS[cell];
+                if (weight > bestWeight)
+                {
+                    bestWeight = weight;
+                    best = cell;
+                }
+            }
+            index++;
+        }
+    }
+    if (best < 0)
+    {
+        // nothing left in range
+        for (int cell = 0; cell < BOARD_CELLS; cell++)
+        {
+            if (board[cell / BOARD_SIZE][cell % BOARD_SIZE] == 0)
+            {
+                return {cell / BOARD_SIZE, cell % BOARD_SIZE};
+            }
+        }
+    }
+    return {best / BOARD_SIZE, best % BOARD_SIZE};
+}
+
+template <class Selection, class Backup>
+SearchNode<Selection, Backup>::SearchNode(SearchNode *node, float heuristic, bool isRed)
+    : _parent(node), _children(), _nVisits(0), _quality(0), _uct(0), _heuristicFactor(heuristic), _isRed(isRed), _proof(0), _amaf() {}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::expand(const MoveBuffer &moves)
+{
+    if (_children.size() == 0)
+    {
+        std::for_each(moves.begin(), moves.end(), [&](const CellPrior &move)
+                      {
+                          action2D action = move.cell.action();
+                          float prob = move.probability;
+                            // _children.insert({action, std::move(std::make_unique<SearchNode>(SearchNode(this, prob, !_isRed))) }); 
+                            _children[action]=std::make_unique<SearchNode>(SearchNode(this, prob, !_isRed)); });
+    }
+    else
+    {
+        std::for_each(moves.begin(), moves.end(), [&](const CellPrior &move)
+                      {
+                      action2D action = move.cell.action();
+                      float prob = move.probability;
+                      auto it = _children.find(action);
+                      if (it == _children.end())
+                      {
+                        //   _children[action]=std::make_unique<SearchNode>(SearchNode(this, prob, !_isRed));
+                          _children.insert(std::make_pair(action, std::make_unique<SearchNode>(SearchNode(this, prob, !_isRed))));
+                      } });
+    }
+}
+
+template <class Selection, class Backup>
+float SearchNode<Selection, Backup>::evaluation(float xplorCoeff, const SearchNode *amafSource)
+{
+    _uct = Selection::exploration(_heuristicFactor, xplorCoeff, _parent->_nVisits, _nVisits);
+
+    return Selection::value(_quality, _nVisits, amafSource == nullptr ? nullptr : &amafSource->_amaf) + _uct;
+}
+
+template <class Selection, class Backup>
+std::unordered_map<action2D, std::unique_ptr<SearchNode<Selection, Backup>>> *SearchNode<Selection, Backup>::getChildren()
+{
+    return &_children;
+}
+
+template <class Selection, class Backup>
+typename std::unordered_map<action2D, std::unique_ptr<SearchNode<Selection, Backup>>>::iterator SearchNode<Selection, Backup>::select(float xplorCoeff, bool isPlayout, SearchNode *reference)
+{
+    if (_children.size() == 0)
+    {
+        return _children.end();
+    }
+    if (isPlayout)
+    {
+        // AMAF statistics of a move: its own, or those of the same move below the reference
+        auto amafSource = [&](const std::pair<const action2D, std::unique_ptr<SearchNode>> &child) -> SearchNode *
+        {
+            if (!Selection::USES_AMAF)
+            {
+                return nullptr;
+            }
+            if (reference == nullptr || reference == this)
+            {
+                return child.second.get();
+            }
+            auto it = reference->_children.find(child.first);
+            return it == reference->_children.end() ? nullptr : it->second.get();
+        };
+        return std::max_element(_children.begin(), _children.end(), [&](const std::pair<const action2D, std::unique_ptr<SearchNode>> &a, const std::pair<const action2D, std::unique_ptr<SearchNode>> &b)
+                                { return a.second.get()->evaluation(xplorCoeff, amafSource(a)) < b.second.get()->evaluation(xplorCoeff, amafSource(b)); });
+    }
+    else
+    {
+        return std::max_element(_children.begin(), _children.end(), [&xplorCoeff](const std::pair<const action2D, std::unique_ptr<SearchNode>> &a, const std::pair<const action2D, std::unique_ptr<SearchNode>> &b)
+                                {
+                                    // proven results dominate visit count
+                                    if (a.second.get()->_proof != b.second.get()->_proof)
+                                        return a.second.get()->_proof < b.second.get()->_proof;
+                                    return a.second.get()->_nVisits < b.second.get()->_nVisits; });
+    }
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::topTwoVisits(int &best, int &second)
+{
+    best = 0;
+    second = 0;
+    auto bestIt = select(0, false);
+    if (bestIt == _children.end())
+    {
+        return;
+    }
+    best = bestIt->second->_nVisits;
+    for (auto &child : _children)
+    {
+        if (child.second.get() != bestIt->second.get() && child.second->_proof >= 0)
+        {
+            second = std::max(second, child.second->_nVisits);
+        }
+    }
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::update(float result, GameState *finalState)
+{
+    _nVisits += 1;
+    _quality += (result - _quality) / _nVisits;
+    if (!Selection::USES_AMAF || finalState == nullptr || (Selection::SPARSE_AMAF && _nVisits < Selection::GRAVE_THRESHOLD))
+    {
+        return;
+    }
+    // every child move its player got to play in the rollout, the result is from the view of this node
+    Bitboard played = finalState->getStones(!_isRed);
+    for (auto &child : _children)
+    {
+        if (played.test(child.first.actionX * BOARD_SIZE + child.first.actionY))
+        {
+            Selection::record(child.second->_amaf, -result);
+        }
+    }
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::update_from_root(float result, GameState *finalState)
+{
+    if (_parent != nullptr)
+    {
+        _parent->update_from_root(-result * Backup::PLY_DISCOUNT, finalState);
+    }
+    update(result, finalState);
+}
+
+template <class Selection, class Backup>
+bool SearchNode<Selection, Backup>::isRed()
+{
+    return _isRed;
+}
+
+template <class Selection, class Backup>
+int SearchNode<Selection, Backup>::getProof()
+{
+    return _proof;
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::setProof(int proof)
+{
+    _proof = proof;
+}
+
+template <class Selection, class Backup>
+int SearchNode<Selection, Backup>::getVisits()
+{
+    return _nVisits;
+}
+
+template <class Selection, class Backup>
+float SearchNode<Selection, Backup>::getQuality()
+{
+    return _quality;
+}
+
+template <class Selection, class Backup>
+float SearchNode<Selection, Backup>::getPrior()
+{
+    return _heuristicFactor;
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::expose()
+{
+    printf("Visit count: %d, qualiity: %f, uct: %f\n", _nVisits, _quality, _uct);
+}
+
+template <class Selection, class Backup>
+void SearchNode<Selection, Backup>::setParentNull()
+{
+    _parent = nullptr;
+}
+
+template <class Selection, class Backup>
+bool SearchNode<Selection, Backup>::isLeaf()
+{
+    return _children.size() == 0;
+}
+
+template <class Selection, class Backup>
+bool SearchNode<Selection, Backup>::isRoot()
+{
+    return _parent == nullptr;
+}
+
+const uint32_t DFPN_INF = 1u << 30;
+
+DfpnSolver::DfpnSolver(int tableBits)
+    : _table(1ULL << tableBits, TTEntry{0, 1, 1}), _tableMask((1ULL << tableBits) - 1), _worker(), _stop(false), _solved(false), _bestMove({0, 0}), _deadline(0), _nodeCounter(0) {}
+
+DfpnSolver::~DfpnSolver()
+{
+    stop();
+}
+
+void DfpnSolver::lookupEntry(uint64_t key, uint32_t &phi, uint32_t &delta)
+{
+    TTEntry &entry = _table[key & _tableMask];
+    if (entry.key == key)
+    {
+        phi = entry.phi;
+        delta = entry.delta;
+    }
+    else
+    {
+        phi = 1;
+        delta = 1;
+    }
+}
+
+void DfpnSolver::storeEntry(uint64_t key, uint32_t phi, uint32_t delta)
+{
+    TTEntry &entry = _table[key & _tableMask];
+    // keep proven results over unproven ones sharing the slot
+    if (entry.key != key && (entry.phi == 0 || entry.delta == 0) && phi != 0 && delta != 0)
+    {
+        return;
+    }
+    entry = {key, phi, delta};
+}
+
+bool DfpnSolver::outOfTime()
+{
+    if (_stop.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    if ((++_nodeCounter & 255) == 0 && searchClock().now() >= _deadline)
+    {
+        _stop.store(true);
+    }
+    return _stop.load(std::memory_order_relaxed);
+}
+
+void DfpnSolver::mid(GameState &state, uint32_t phiThreshold, uint32_t deltaThreshold)
+{
+    uint64_t key = state.getCanonicalKey();
+    // player who just moved has connected, the player to move lost
+    if (state.lastPlayerWon())
+    {
+        storeEntry(key, DFPN_INF, 0);
+        return;
+    }
+    CellBuffer actions;
+    state.legalCells(actions);
+    FixedBuffer<uint64_t, BOARD_CELLS> childKeys;
+    for (auto cell : actions)
+    {
+        childKeys.push_back(state.canonicalKeyAfter(cell.action()));
+    }
+    while (!outOfTime())
+    {
+        // OR node: phi is the smallest child delta, delta is the sum of child phi
+        uint32_t phi = DFPN_INF, delta = 0;
+        uint32_t bestDelta = DFPN_INF, secondDelta = DFPN_INF, bestPhi = DFPN_INF;
+        int best = -1;
+        for (int i = 0; i < actions.size(); i++)
+        {
+            uint32_t childPhi, childDelta;
+            lookupEntry(childKeys[i], childPhi, childDelta);
+            delta = std::min(DFPN_INF, delta + childPhi);
+            if (childDelta < bestDelta)
+            {
+                secondDelta = bestDelta;
+                bestDelta = childDelta;
+                bestPhi = childPhi;
+                best = i;
+            }
+            else if (childDelta < secondDelta)
+            {
+                secondDelta = childDelta;
+            }
+        }
+        phi = bestDelta;
+        if (phi >= phiThreshold || delta >= deltaThreshold || best == -1)
+        {
+            storeEntry(key, phi, delta);
+            return;
+        }
+        GameState child = state;
+        child.plays(actions[best].action());
+        uint32_t childPhiThreshold = deltaThreshold - delta + bestPhi;
+        uint32_t childDeltaThreshold = std::min(phiThreshold, secondDelta + 1);
+        mid(child, childPhiThreshold, childDeltaThreshold);
+    }
+}
+
+void DfpnSolver::run(GameState state)
+{
+    mid(state, DFPN_INF - 1, DFPN_INF - 1);
+    uint32_t phi, delta;
+    lookupEntry(state.getCanonicalKey(), phi, delta);
+    if (phi != 0)
+    {
+        return;
+    }
+    CellBuffer actions;
+    state.legalCells(actions);
+    for (auto cell : actions)
+    {
+        uint32_t childPhi, childDelta;
+        lookupEntry(state.canonicalKeyAfter(cell.action()), childPhi, childDelta);
+        if (childDelta == 0)
+        {
+            _bestMove = cell.action();
+            _solved.store(true);
+            return;
+        }
+    }
+}
+
+void DfpnSolver::start(GameState state, time_t deadline)
+{
+    stop();
+    _stop.store(false);
+    _solved.store(false);
+    _deadline = deadline;
+    _nodeCounter = 0;
+    _worker = std::thread(&DfpnSolver::run, this, state);
+}
+
+void DfpnSolver::stop()
+{
+    _stop.store(true);
+    if (_worker.joinable())
+    {
+        _worker.join();
+    }
+}
+
+bool DfpnSolver::solved()
+{
+    return _solved.load();
+}
+
+action2D DfpnSolver::getBestMove()
+{
+    return _bestMove;
+}
+
+int DfpnSolver::lookup(GameState &state)
+{
+    uint32_t phi, delta;
+    lookupEntry(state.getCanonicalKey(), phi, delta);
+    if (phi == 0)
+    {
+        return 1;
+    }
+    if (delta == 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+VCEngine::VCEngine(bool isRed, int maxFull, int maxSemi, int maxOr)
+    : _isRed(isRed), _maxFull(maxFull), _maxSemi(maxSemi), _maxOr(maxOr), _parent(), _mine(), _empty(), _full(), _semi(), _pending(), _pendingHead(0)
+{
+    GameState empty;
+    reset(empty);
+}
+
+int VCEngine::find(int point)
+{
+    while (_parent[point] != point)
+    {
+        _parent[point] = _parent[_parent[point]];
+        point = _parent[point];
+    }
+    return point;
+}
+
+void VCEngine::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b)
+    {
+        return;
+    }
+    // edges stay roots, a group touching an edge is the edge
+    if (b >= EDGE_START && a < EDGE_START)
+    {
+        std::swap(a, b);
+    }
+    _parent[b] = a;
+}
+
+int VCEngine::pairIndex(int x, int y)
+{
+    return x < y ? x * POINTS + y : y * POINTS + x;
+}
+
+bool VCEngine::isPoint(int point)
+{
+    if (point < EDGE_START && _empty.test(point))
+    {
+        return true;
+    }
+    return (point >= EDGE_START || _mine.test(point)) && find(point) == point;
+}
+
+int VCEngine::pointOf(int cell)
+{
+    return _mine.test(cell) ? find(cell) : cell;
+}
+
+void VCEngine::reset(GameState &state)
+{
+    for (int i = 0; i < POINTS; i++)
+    {
+        _parent[i] = i;
+    }
+    _mine = state.getStones(_isRed);
+    _empty = state.emptyCells();
+    _full.assign(POINTS * POINTS, std::vector<Bitboard>());
+    _semi.assign(POINTS * POINTS, std::vector<SemiConnection>());
+    _pending.clear();
+    _pendingHead = 0;
+
+    for (int cell = 0; cell < BOARD_CELLS; cell++)
+    {
+        const CellTopology &topology = TOPOLOGY[cell];
+        const unsigned char *edgeDistance = topology.edgeDistance + (_isRed ? 0 : 2);
+        if (!_mine.test(cell))
+        {
+            continue;
+        }
+        if (edgeDistance[0] == 0 || edgeDistance[1] == 0)
+        {
+            unite(edgeDistance[0] == 0 ? EDGE_START : EDGE_END, cell);
+        }
+        for (int i = 0; i < topology.neighborCount; i++)
+        {
+            if (_mine.test(topology.neighbors[i]))
+            {
+                unite(cell, topology.neighbors[i]);
+            }
+        }
+    }
+
+    // adjacent points are fully connected with an empty carrier
+    Bitboard empty = {{0, 0}};
+    for (int cell = 0; cell < BOARD_CELLS; cell++)
+    {
+        if (!_mine.test(cell) && !_empty.test(cell))
+        {
+            continue;
+        }
+        const CellTopology &topology = TOPOLOGY[cell];
+        const unsigned char *edgeDistance = topology.edgeDistance + (_isRed ? 0 : 2);
+        if (edgeDistance[0] == 0 || edgeDistance[1] == 0)
+        {
+            addFull(pointOf(cell), edgeDistance[0] == 0 ? EDGE_START : EDGE_END, empty);
+        }
+        for (int dir = 0; dir < 3; dir++)
+        {
+            int next = topology.ring[dir];
+            if (next != cell && (_mine.test(next) || _empty.test(next)))
+            {
+                addFull(pointOf(cell), pointOf(next), empty);
+            }
+        }
+    }
+}
+
+void VCEngine::addFull(int x, int y, Bitboard carrier)
+{
+    if (x == y)
+    {
+        return;
+    }
+    int idx = pairIndex(x, y);
+    auto &list = _full[idx];
+    for (auto &known : list)
+    {
+        if ((known & carrier) == known)
+        {
+            return;
+        }
+    }
+    list.erase(std::remove_if(list.begin(), list.end(), [&](const Bitboard &known)
+                              { return (known & carrier) == carrier; }),
+               list.end());
+    if ((int)list.size() >= _maxFull)
+    {
+        auto largest = std::max_element(list.begin(), list.end(), [](const Bitboard &a, const Bitboard &b)
+                                        { return a.count() < b.count(); });
+        if (largest->count() <= carrier.count())
+        {
+            return;
+        }
+        *largest = carrier;
+    }
+    else
+    {
+        list.push_back(carrier);
+    }
+    // semi connections containing a full one add nothing
+    auto &semis = _semi[idx];
+    semis.erase(std::remove_if(semis.begin(), semis.end(), [&](const SemiConnection &semi)
+                               { return (semi.carrier & carrier) == carrier; }),
+                semis.end());
+    _pending.push_back({x, y, carrier});
+}
+
+void VCEngine::addSemi(int x, int y, Bitboard carrier, int key)
+{
+    if (x == y)
+    {
+        return;
+    }
+    int idx = pairIndex(x, y);
+    for (auto &known : _full[idx])
+    {
+        if ((known & carrier) == known)
+        {
+            return;
+        }
+    }
+    auto &list = _semi[idx];
+    for (auto &known : list)
+    {
+        if ((known.carrier & carrier) == known.carrier)
+        {
+            return;
+        }
+    }
+    list.erase(std::remove_if(list.begin(), list.end(), [&](const SemiConnection &known)
+                              { return (known.carrier & carrier) == carrier; }),
+               list.end());
+    if ((int)list.size() >= _maxSemi)
+    {
+        auto largest = std::max_element(list.begin(), list.end(), [](const SemiConnection &a, const SemiConnection &b)
+                                        { return a.carrier.count() < b.carrier.count(); });
+        if (largest->carrier.count() <= carrier.count())
+        {
+            return;
+        }
+        *largest = {carrier, key};
+    }
+    else
+    {
+        list.push_back({carrier, key});
+    }
+    combine(x, y);
+}
+
+void VCEngine::combine(int x, int y)
+{
+    auto &list = _semi[pairIndex(x, y)];
+    // greedy from each semi connection, take the ones that shrink the intersection
+    for (size_t first = 0; first < list.size(); first++)
+    {
+        Bitboard intersection = list[first].carrier;
+        Bitboard carrier = list[first].carrier;
+        int used = 1;
+        for (size_t i = 0; i < list.size() && used < _maxOr; i++)
+        {
+            if ((list[i].carrier & intersection) == intersection)
+            {
+                continue;
+            }
+            intersection = intersection & list[i].carrier;
+            carrier = carrier | list[i].carrier;
+            used++;
+            if (!intersection.any())
+            {
+                addFull(x, y, carrier);
+                return;
+            }
+        }
+    }
+}
+
+void VCEngine::andRule(PendingAnd &vc)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        int mid = side == 0 ? vc.x : vc.y;
+        int other = side == 0 ? vc.y : vc.x;
+        // edges are no midpoints, everything along them would connect
+        if (mid >= EDGE_START)
+        {
+            continue;
+        }
+        bool stoneMid = _mine.test(mid);
+        for (int z = 0; z < POINTS; z++)
+        {
+            if (z == mid || z == other || !isPoint(z) || (z < EDGE_START && vc.carrier.test(z)))
+            {
+                continue;
+            }
+            auto &list = _full[pairIndex(mid, z)];
+            for (size_t i = 0; i < list.size(); i++)
+            {
+                Bitboard carrier = list[i];
+                if ((carrier & vc.carrier).any() || (other < EDGE_START && carrier.test(other)))
+                {
+                    continue;
+                }
+                if (stoneMid)
+                {
+                    addFull(other, z, carrier | vc.carrier);
+                }
+                else
+                {
+                    addSemi(other, z, (carrier | vc.carrier) | Bitboard::single(mid), mid);
+                }
+            }
+        }
+    }
+}
+
+void VCEngine::play(int cell, bool isRed)
 {
-    std::vector<action2D> result = std::vector<action2D>();
-    int col = action.actionY;
-    int row = action.actionX;
-    if (col > 0)
+    if (!_empty.test(cell))
     {
-        action2D tmp = {row, col - 1};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
-        {
-            result.push_back(tmp);
-            pieceList.erase(it);
-        }
+        return;
     }
-    if (col < 10)
+    _empty.reset(cell);
+    if (isRed != _isRed)
     {
-        action2D tmp = {row, col + 1};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
+        // connections ending at or running through the cell are broken
+        for (int x = 0; x < POINTS; x++)
         {
-            result.push_back(tmp);
-            pieceList.erase(it);
+            for (int y = x + 1; y < POINTS; y++)
+            {
+                int idx = x * POINTS + y;
+                auto &full = _full[idx];
+                auto &semi = _semi[idx];
+                if (full.empty() && semi.empty())
+                {
+                    continue;
+                }
+                if (x == cell || y == cell)
+                {
+                    full.clear();
+                    semi.clear();
+                    continue;
+                }
+                size_t fullBefore = full.size();
+                full.erase(std::remove_if(full.begin(), full.end(), [&](const Bitboard &carrier)
+                                          { return carrier.test(cell); }),
+                           full.end());
+                semi.erase(std::remove_if(semi.begin(), semi.end(), [&](const SemiConnection &s)
+                                          { return s.carrier.test(cell); }),
+                           semi.end());
+                if (full.size() < fullBefore && full.empty())
+                {
+                    combine(x, y);
+                }
+            }
         }
+        return;
+    }
+
+    // an own stone in a carrier only helps: carriers shrink, semi connections keyed on it
+    // become full, and the connections of the merged groups move to the new root
+    const unsigned char *edgeDistance = TOPOLOGY[cell].edgeDistance + (_isRed ? 0 : 2);
+    std::array<bool, POINTS> merged = {};
+    merged[cell] = true;
+    if (edgeDistance[0] == 0 || edgeDistance[1] == 0)
+    {
+        merged[edgeDistance[0] == 0 ? EDGE_START : EDGE_END] = true;
+    }
+    // own stones around the new one
+    Bitboard adjacent = TOPOLOGY[cell].ring1 & _mine;
+    for (int next = adjacent.lowest(); next >= 0; next = adjacent.lowest())
+    {
+        adjacent.reset(next);
+        merged[find(next)] = true;
     }
-    if (row > 0)
+
+    std::vector<PendingAnd> moved;
+    std::vector<PendingAnd> movedSemi;
+    std::vector<int> movedKeys;
+    for (int a = 0; a < POINTS; a++)
     {
-        action2D tmp = {row - 1, col};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
+        for (int b = a + 1; b < POINTS; b++)
         {
-            result.push_back(tmp);
-            pieceList.erase(it);
+            int idx = a * POINTS + b;
+            auto &full = _full[idx];
+            auto &semi = _semi[idx];
+            bool ends = merged[a] || merged[b];
+            for (size_t i = 0; i < full.size();)
+            {
+                if (ends || full[i].test(cell))
+                {
+                    Bitboard carrier = full[i];
+                    carrier.reset(cell);
+                    moved.push_back({a, b, carrier});
+                    full.erase(full.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            for (size_t i = 0; i < semi.size();)
+            {
+                if (ends || semi[i].carrier.test(cell))
+                {
+                    Bitboard carrier = semi[i].carrier;
+                    carrier.reset(cell);
+                    movedSemi.push_back({a, b, carrier});
+                    movedKeys.push_back(semi[i].key);
+                    semi.erase(semi.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
         }
     }
 
-    if (row > 0 && col < 10)
+    _mine.set(cell);
+    for (int point = 0; point < POINTS; point++)
     {
-        action2D tmp = {row - 1, col + 1};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
+        if (merged[point])
         {
-            result.push_back(tmp);
-            pieceList.erase(it);
+            unite(cell, point);
         }
     }
-    if (row < 10)
+
+    for (auto &vc : moved)
+    {
+        addFull(find(vc.x), find(vc.y), vc.carrier);
+    }
+    for (size_t i = 0; i < movedSemi.size(); i++)
     {
-        action2D tmp = {row + 1, col};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
+        int a = find(movedSemi[i].x), b = find(movedSemi[i].y);
+        if (movedKeys[i] == cell)
         {
-            result.push_back(tmp);
-            pieceList.erase(it);
+            addFull(a, b, movedSemi[i].carrier);
+        }
+        else
+        {
+            addSemi(a, b, movedSemi[i].carrier, movedKeys[i]);
         }
     }
-    if (row < 10 && col > 0)
+    // the group is a new midpoint for the AND rule
+    int root = find(cell);
+    for (int z = 0; z < POINTS; z++)
     {
-        action2D tmp = {row + 1, col - 1};
-        auto it = std::find(pieceList.begin(), pieceList.end(), tmp);
-        if (it != pieceList.end())
+        if (z != root && isPoint(z))
         {
-            result.push_back(tmp);
-            pieceList.erase(it);
+            for (auto &carrier : _full[pairIndex(root, z)])
+            {
+                _pending.push_back({root, z, carrier});
+            }
         }
     }
-    return result;
-};
+}
 
-/**
- * @brief DFS style search
- *
- * @param frontier list
- * @param pieceList list
- * @param isRed if the check is for red player
- * @return true checked player won
- * @return false checked player haven't won
- */
-bool dfs(std::vector<action2D> &frontier, std::vector<action2D> &pieceList, bool isRed)
+bool VCEngine::search(double deadline)
 {
-    if (frontier.size() == 0)
-    {
-        return false;
-    }
-    else
+    int steps = 0;
+    while (_pendingHead < _pending.size())
     {
-        auto node = frontier.back();
-        frontier.pop_back();
-        if (isRed && node.actionX == 10)
+        if ((++steps & 63) == 0 && searchClock().now() > deadline)
+        {
+            return false;
+        }
+        PendingAnd vc = _pending[_pendingHead++];
+        // skip connections dropped or moved since they were queued
+        if (!isPoint(vc.x) || !isPoint(vc.y))
         {
-            return true;
+            continue;
         }
-        if (!isRed && node.actionY == 10)
+        auto &list = _full[pairIndex(vc.x, vc.y)];
+        if (std::find(list.begin(), list.end(), vc.carrier) == list.end())
         {
-            return true;
+            continue;
+        }
+        andRule(vc);
+        if (_pendingHead > 4096 && _pendingHead * 2 > _pending.size())
+        {
+            _pending.erase(_pending.begin(), _pending.begin() + _pendingHead);
+            _pendingHead = 0;
         }
-
-        auto newFrontier = findLinkedNodes(node, pieceList);
-        std::move(newFrontier.begin(), newFrontier.end(), std::back_inserter(frontier));
-        return dfs(frontier, pieceList, isRed);
     }
+    _pending.clear();
+    _pendingHead = 0;
+    return true;
 }
 
-std::array<char, 4> computeRangeBound(action2D action, int hexRange)
+bool VCEngine::connected(Bitboard &carrier)
 {
-    char left_bound = std::max(0, action.actionX - hexRange);
-    char right_bound = std::min(10, action.actionX + hexRange);
-    char up_bound = std::max(0, action.actionY - hexRange);
-    char bot_bound = std::min(10, action.actionY + hexRange);
+    carrier = Bitboard{{0, 0}};
+    if (find(EDGE_START) == find(EDGE_END))
+    {
+        return true;
+    }
+    auto &list = _full[pairIndex(EDGE_START, EDGE_END)];
+    if (list.empty())
+    {
+        return false;
+    }
+    carrier = *std::min_element(list.begin(), list.end(), [](const Bitboard &a, const Bitboard &b)
+                                { return a.count() < b.count(); });
+    return true;
+}
 
-    return {left_bound, right_bound, up_bound, bot_bound};
+Bitboard VCEngine::winningKeys()
+{
+    Bitboard keys = {{0, 0}};
+    if (find(EDGE_START) == find(EDGE_END))
+    {
+        return keys;
+    }
+    for (auto &semi : _semi[pairIndex(EDGE_START, EDGE_END)])
+    {
+        keys.set(semi.key);
+    }
+    return keys;
 }
 
-time_t getTimeInMilis()
+bool VCEngine::threats(Bitboard &region)
 {
-    timeval time;
-    gettimeofday(&time, NULL);
-    time_t msecs_time = (time.tv_sec * 1000) + (time.tv_usec / 1000);
-    return msecs_time;
+    region = ~Bitboard{{0, 0}};
+    auto &list = _semi[pairIndex(EDGE_START, EDGE_END)];
+    if (find(EDGE_START) == find(EDGE_END) || list.empty())
+    {
+        return false;
+    }
+    for (auto &semi : list)
+    {
+        region = region & semi.carrier;
+    }
+    return true;
 }
 
-//*************************End of Helper Functions
+TimeManager::TimeManager(time_t turnLimit, time_t firstTurnLimit, bool limitOnCpu, double checkInterval)
+    : _turnLimit(turnLimit), _firstTurnLimit(firstTurnLimit), _safetyRatio(0.95), _limitOnCpu(limitOnCpu), _turn(0), _turnStart(0), _turnCpuStart(0), _softBudget(0), _standardBudget(0), _hardBudget(0), _timeBank(0), _checkInterval(checkInterval) {}
 
-// Member function Impl
-GameState::GameState() : board{}, totalPieces(0)
+void TimeManager::startTurn(time_t startTime, float timeMultiplier)
 {
+    // elapsed is read on the search clock against startTime from steady_clock, both agree
+    // from here on
+    searchClock().rebase();
+    _turnStart = startTime;
+    _turnCpuStart = getCpuTimeInMilis();
+    time_t limit = (_turn == 0 ? _firstTurnLimit : _turnLimit) * timeMultiplier;
+    _hardBudget = limit * _safetyRatio;
+    _standardBudget = limit * 0.87;
+    _softBudget = _standardBudget;
+    _turn++;
 }
 
-bool GameState::boardIsFull()
+void TimeManager::plan(int totalPieces, int candidates)
 {
-    return totalPieces == 121;
+    time_t limit = _hardBudget / _safetyRatio;
+    if (candidates <= 1)
+    {
+        // forced move, nothing to search
+        _softBudget = 0;
+    }
+    else if (totalPieces < 10)
+    {
+        // opening, the tree is wide and playouts tell little
+        _softBudget = limit * 0.6;
+    }
+    else if (totalPieces < 60)
+    {
+        // middle game, where the game is decided
+        _softBudget = _standardBudget;
+    }
+    else
+    {
+        _softBudget = limit * 0.75;
+    }
+    _softBudget = std::min(_softBudget, _hardBudget);
 }
 
-void GameState::recoverState()
+time_t TimeManager::elapsed()
 {
-    // 读入JSON
-    std::string str;
-    getline(std::cin, str);
-    Json::Reader reader;
-    Json::Value input;
-    reader.parse(str, input);
-    // 分析自己收到的输入和自己过往的输出，并恢复状态
-    int turnID = input["responses"].size();
-    for (int i = 0; i < turnID; i++)
+    if (_limitOnCpu)
     {
-        plays({input["requests"][i]["x"].asInt(), input["requests"][i]["y"].asInt()});
-        plays({input["responses"][i]["x"].asInt(), input["responses"][i]["y"].asInt()});
+        return getCpuTimeInMilis() - _turnCpuStart;
     }
-    plays({input["requests"][turnID]["x"].asInt(), input["requests"][turnID]["y"].asInt()});
+    return (time_t)searchClock().now() - _turnStart;
 }
 
-bool GameState::redPlaysNext()
+time_t TimeManager::remaining(bool critical)
 {
-    return totalPieces % 2 == 0;
+    time_t budget = _softBudget;
+    if (critical)
+    {
+        // critical moves draw on the bank, never past the hard budget
+        budget = std::min(_hardBudget, _softBudget + _timeBank);
+    }
+    return budget - elapsed();
 }
 
-bool GameState::redPlayedLast()
+bool TimeManager::shouldStop(bool critical)
 {
-    return !redPlaysNext();
+    return remaining(critical) <= 0;
 }
 
-bool GameState::plays(int action)
+time_t TimeManager::hardDeadline()
 {
-    if (action >= 0 and action < 121)
-    {
-        int actionX = action / 11;
-        int actionY = action % 11;
-        action2D a2d = {actionX, actionY};
-        return GameState::plays(a2d);
-    }
-    else
-    {
-        return false;
-    }
+    return _turnStart + _hardBudget;
 }
 
-bool GameState::plays(action2D action)
+time_t TimeManager::emergencyDeadline()
+{
+    return _turnStart + _hardBudget / _safetyRatio * 0.98;
+}
+
+int TimeManager::nextBatch(double msPerPlayout)
+{
+    // overshoot of the deadline is at most one batch
+    int batch = _checkInterval / std::max(msPerPlayout, 1e-3);
+    return std::max(1, std::min(batch, 1000));
+}
+
+void TimeManager::endTurn()
+{
+    // unused standard budget is banked, time spent beyond it is withdrawn
+    _timeBank = std::max((time_t)0, _timeBank + _standardBudget - elapsed());
+}
+
+time_t TimeManager::getTimeBank()
+{
+    return _timeBank;
+}
+
+Watchdog::Watchdog()
+    : _worker(), _mutex(), _cv(), _emit(), _armed(false), _quit(false), _responded(false), _deadline(0), _emitted({0, 0}), _fired(false), _bestSoFar(-1)
+{
+    _worker = std::thread(&Watchdog::run, this);
+}
+
+Watchdog::~Watchdog()
 {
-    if (action.actionX >= 0 && action.actionX < 11 && action.actionY >= 0 && action.actionY < 11)
-    {
-        board[action.actionX][action.actionY] = (totalPieces % 2 == 0) ? 1 : -1;
-        totalPieces += 1;
-        return true;
-    }
-    else
     {
-        return false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
     }
+    _cv.notify_all();
+    _worker.join();
 }
 
-bool GameState::oneSideTest(bool isRed)
+void Watchdog::run()
 {
-    std::vector<action2D> pieceLocs;
-    for (int i = 0; i < 11; i++)
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_quit)
     {
-        for (int j = 0; j < 11; j++)
+        if (!_armed)
+        {
+            _cv.wait(lock);
+            continue;
+        }
+        auto deadline = std::chrono::steady_clock::time_point(std::chrono::milliseconds(_deadline));
+        if (_cv.wait_until(lock, deadline, [this]
+                           { return !_armed || _quit; }))
+        {
+            continue;
+        }
+        // deadline reached while the search is still running
+        _armed = false;
+        _fired.store(true);
+        int cell = _bestSoFar.load();
+        _emitted = {cell / BOARD_SIZE, cell % BOARD_SIZE};
+        if (!_responded && cell >= 0)
         {
-            if (board[i][j] == (isRed ? 1 : -1))
+            _responded = true;
+            if (_emit)
             {
-
-                pieceLocs.push_back(action2D{i, j});
+                _emit(_emitted);
             }
         }
     }
-    int piece_count = pieceLocs.size();
-    if (piece_count < 11)
+}
+
+void Watchdog::setEmitter(std::function<void(action2D)> emit)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _emit = emit;
+}
+
+void Watchdog::arm(time_t deadline, action2D fallback)
+{
     {
-        return false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _deadline = deadline;
+        _responded = false;
+        _fired.store(false);
+        _bestSoFar.store(fallback.actionX * BOARD_SIZE + fallback.actionY);
+        _armed = true;
     }
-    else
+    _cv.notify_all();
+}
+
+bool Watchdog::disarm(action2D &emitted)
+{
+    bool answered = false;
     {
-        // find starting locations
-        std::vector<action2D> startingLocs;
-        std::vector<action2D> pieceList;
-        for (auto it = pieceLocs.begin(); it != pieceLocs.end(); it++)
+        std::lock_guard<std::mutex> lock(_mutex);
+        _armed = false;
+        if (_fired.load() && _responded)
         {
-            if ((isRed && it->actionX == 0) || (!isRed && it->actionY == 0))
-            {
-                startingLocs.push_back(*it);
-            }
-            else
-            {
-                pieceList.push_back(*it);
-            }
+            emitted = _emitted;
+            answered = true;
         }
-        if (startingLocs.size() == 0)
-            return false;
-
-        // std::copy_if(pieceLocs.begin(), pieceLocs.end(), std::back_inserter(startingLocs), [isRed](action2D loc) -> bool
-        //              { return (isRed && loc.actionX == 0 || !isRed && loc.actionY == 0) ? true : false; });
-
-        // for (int i = 1; i < 11; i++)
-        // {
-        //     int prevListSize = pieceList.size();
-        //     std::copy_if(pieceLocs.begin(), pieceLocs.end(), std::back_inserter(startingLocs), [isRed, i](action2D loc) -> bool
-        //                  { return (isRed && loc.actionX == i || !isRed && loc.actionY == i) ? true : false; });
-        //     if (pieceList.size() - prevListSize == 0)
-        //         return false;
-        // }
-        // std::for_each(pieceLocs.begin(), pieceLocs.end(), [](action2D action)
-        //               { printf("action x:%d, y:%d\n", action.actionX, action.actionY); });
-        return dfs(startingLocs, pieceList, isRed);
     }
+    _cv.notify_all();
+    return answered;
 }
 
-bool GameState::lastPlayerWon()
+void Watchdog::setBestSoFar(action2D action)
 {
-    bool isRed = redPlayedLast();
-    return oneSideTest(isRed);
+    _bestSoFar.store(action.actionX * BOARD_SIZE + action.actionY, std::memory_order_relaxed);
 }
 
-int GameState::checkTermination()
+bool Watchdog::fired()
 {
-    if (oneSideTest(true))
-    {
-        return 1;
-    }
-    else if (oneSideTest(false))
+    return _fired.load(std::memory_order_relaxed);
+}
+
+void Watchdog::respond(action2D action)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_responded)
     {
-        return -1;
+        return;
     }
-    else
+    _responded = true;
+    // answered, nothing left to guard
+    _armed = false;
+    if (_emit)
     {
-        return 0;
+        _emit(action);
     }
 }
 
-void GameState::setState(signed char b[][11])
+const char BOOK_MAGIC[8] = {'H', 'E', 'X', 'B', 'O', 'O', 'K', '1'};
+// 2: canonical keys and moves
+const uint32_t BOOK_VERSION = 2;
+
+OpeningBook::OpeningBook() : _mapping(nullptr), _mappingSize(0), _records(nullptr), _count(0) {}
+
+OpeningBook::~OpeningBook()
 {
-    int counter = 0;
-    for (int i = 0; i < 11; i++)
+    if (_mapping != nullptr)
     {
-        for (int j = 0; j < 11; j++)
-        {
-            board[i][j] = b[i][j];
-            if (b[i][j] != 0)
-            {
-                counter++;
-            }
-        }
+        munmap(_mapping, _mappingSize);
     }
-    totalPieces = counter;
 }
 
-void GameState::printBoard()
+bool OpeningBook::open(const char *path)
 {
-    for (int i = 0; i < 11; i++)
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
     {
-        std::cout << std::string(i * 2, ' ');
-        for (auto v : board[i])
-        {
-            std::cout.width(3);
-            std::cout << (short)v;
-        }
-        std::cout << std::endl;
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(BookHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    const BookHeader *header = (const BookHeader *)mapping;
+    if (memcmp(header->magic, BOOK_MAGIC, 8) != 0 || header->version != BOOK_VERSION ||
+        sizeof(BookHeader) + (size_t)header->count * sizeof(BookRecord) > (size_t)fileStat.st_size)
+    {
+        munmap(mapping, fileStat.st_size);
+        return false;
     }
+    if (_mapping != nullptr)
+    {
+        munmap(_mapping, _mappingSize);
+    }
+    _mapping = mapping;
+    _mappingSize = fileStat.st_size;
+    _records = (const BookRecord *)((const char *)mapping + sizeof(BookHeader));
+    _count = header->count;
+    return true;
 }
 
-std::vector<ActionPrior> GameState::outputActionPrior(bool forcedFirst, action2D forcedPlay)
+uint32_t OpeningBook::size()
 {
-    std::vector<action2D> actions;
-    std::vector<ActionPrior> apPairs;
-    if (totalPieces == 0 && forcedFirst)
-    {
-        actions.push_back(forcedPlay);
-    }
-    else
+    return _count;
+}
+
+bool OpeningBook::probe(GameState &state, action2D &action)
+{
+    uint64_t key = state.getCanonicalKey();
+    bool rotated = state.canonicalIsRotated();
+    const BookRecord *it = std::lower_bound(_records, _records + _count, key, [](const BookRecord &record, uint64_t k)
+                                            { return record.key < k; });
+    const BookRecord *best = nullptr;
+    Bitboard empty = state.emptyCells();
+    for (; it != _records + _count && it->key == key; it++)
     {
-        int range = 0;
-        // force ignore border bound for first 10 moves,
-        // force ignore border 2 rows for first 4 moves
-        if (totalPieces <= 4)
+        // a move off the board or on an occupied cell means a hash collision
+        if (it->actionX > BOARD_LAST || it->actionY > BOARD_LAST)
         {
-            range = 3;
+            continue;
         }
-        else if (totalPieces <= 8)
+        action2D move = {it->actionX, it->actionY};
+        if (rotated)
         {
-            range = 2;
+            move = GameState::rotate(move);
         }
-        else if (totalPieces <= 12)
+        if (!empty.test(move.actionX * BOARD_SIZE + move.actionY))
         {
-            range = 1;
+            continue;
         }
-        for (int i = 0 + range; i < 11 - range; i++)
+        if (best == nullptr || it->visits > best->visits)
         {
-            for (int j = 0 + range; j < 11 - range; j++)
-            {
-                if (board[i][j] == 0)
-                {
-                    actions.push_back(action2D{i, j});
-                }
-            }
+            best = it;
         }
     }
-    std::for_each(actions.begin(), actions.end(), [&](action2D action)
-                  {
-                      float heuristicMultiplier = 1.0;
-                     // with in range 2, there is a piece, multiplier*1.1
-                    //   auto [l, r, u, b] = computeRangeBound(action, 2);
-                    //   if(isRed){
-                    //       l += 1;
-                    //       r -= 1;
-                    //   }else{
-                    //       u += 1;
-                    //       b -= 1;
-                    //   }
-                    //   for (int i = u; i < b + 1; i++)
-                    //   {
-                    //       for (int j = l; j < r + 1; j++)
-                    //       {
-                    //           if (board[i][j] == (isRed?1:-1) && presenseIndicator==false)
-                    //           {
-                    //               heuristicMultiplier *= 1.2;
-                    //               // break
-                    //               i = b+1;
-                    //               j = r+1;
-                    //               presenseIndicator = true;
-                    //           }
-                    //       }
-                    //   }
-                    //   // bridge pattern multiplier*1.25
-                     auto [l1, r1, u1, b1] = computeRangeBound(action, 1);
-                      char blackPiece = 0, redPiece = 0;
-                      for (int i = u1; i < b1 + 1; i++)
-                      {
-                          for (int j = l1; j < r1 + 1; j++)
-                          {
-                              if (board[i][j] == 1)
-                              {
-                                  redPiece += 1;
-                              }
-                              if (board[i][j] == -1)
-                              {
-                                  blackPiece += 1;
-                              }
-                          }
-                      }
-                      if ((redPiece >= 1 && blackPiece > 1) || (redPiece > 1 && blackPiece >= 1))
-                      {
-                          heuristicMultiplier *= 2;
-                      }
-                      if(redPiece+blackPiece>=4){
-                          heuristicMultiplier *= 2;
-                      }
-
-                    //   // if close to border, multiplier*0.8
-                    //   if (u1 * r1 == 0 || b1 == 10 || l1 == 10)
-                    //   {
-                    //       heuristicMultiplier *= 0.8;
-                    //   }
-                    if( action.actionX>=2 &&  action.actionX<=9 && action.actionY>=2 &&  action.actionY<=9){
-                        heuristicMultiplier *= 1.5;
-                    }
-                      apPairs.push_back({action, heuristicMultiplier}); });
-    return apPairs;
-}
-
-MCTSNode::MCTSNode(MCTSNode *node, float heuristic, bool isRed)
-    : _parent(node), _children(), _nVisits(0), _quality(0), _uct(0), _heuristicFactor(heuristic), _isRed(isRed) {}
-
-void MCTSNode::expand(std::vector<ActionPrior> apPairs)
-{
-    if (_children.size() == 0)
+    if (best == nullptr)
     {
-        std::for_each(apPairs.begin(), apPairs.end(), [&](ActionPrior ap)
-                      {
-                          auto [action, prob] = ap;
-                            // _children.insert({action, std::move(std::make_unique<MCTSNode>(MCTSNode(this, prob, !_isRed))) }); 
-                            _children[action]=std::make_unique<MCTSNode>(MCTSNode(this, prob, !_isRed)); });
+        return false;
     }
-    else
+    action = {best->actionX, best->actionY};
+    if (rotated)
     {
-        std::for_each(apPairs.begin(), apPairs.end(), [&](ActionPrior ap)
-                      {
-                      auto [action, prob] = ap;
-                      auto it = _children.find(action);
-                      if (it == _children.end())
-                      {
-                        //   _children[action]=std::make_unique<MCTSNode>(MCTSNode(this, prob, !_isRed));
-                          _children.insert(std::make_pair(action, std::make_unique<MCTSNode>(MCTSNode(this, prob, !_isRed))));
-                      } });
+        action = GameState::rotate(action);
     }
+    return true;
 }
 
-float MCTSNode::evaluation(float xplorCoeff)
+ResistanceEvaluator::ResistanceEvaluator() : _voltage(), _link(), _toFirst(), _toLast(), _diagonal(), _iterations(0)
 {
-    _uct = _heuristicFactor * xplorCoeff * sqrt(2 * log(_parent->_nVisits)) /
-           (1 + _nVisits);
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
+    {
+        // linear drop from the first to the last edge, a fair start for both sides
+        _voltage[0][idx] = 1.0 - (idx / BOARD_SIZE + 0.5) / BOARD_SIZE;
+        _voltage[1][idx] = 1.0 - (idx % BOARD_SIZE + 0.5) / BOARD_SIZE;
+    }
+}
 
-    return _quality + _uct;
+void ResistanceEvaluator::buildCircuit(GameState &state, bool isRed)
+{
+    // own stones are not short circuits, which would leave the system singular
+    const double ownResistance = 0.01;
+    // leak to ground, keeps cells cut off from both edges solvable
+    const double leak = 1e-6;
+    Bitboard own = state.getStones(isRed);
+    Bitboard passable = own | state.emptyCells();
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
+    {
+        _link[idx].fill(0);
+        _toFirst[idx] = _toLast[idx] = 0;
+        if (!passable.test(idx))
+        {
+            _diagonal[idx] = 1;
+            continue;
+        }
+        double resistance = own.test(idx) ? ownResistance : 1.0;
+        double sum = leak;
+        for (int dir = 0; dir < 6; dir++)
+        {
+            int next = TOPOLOGY[idx].ring[dir];
+            if (next != idx && passable.test(next))
+            {
+                _link[idx][dir] = 1.0 / (resistance + (own.test(next) ? ownResistance : 1.0));
+                sum += _link[idx][dir];
+            }
+        }
+        int line = isRed ? idx / BOARD_SIZE : idx % BOARD_SIZE;
+        if (line == 0)
+        {
+            _toFirst[idx] = 1.0 / resistance;
+        }
+        if (line == BOARD_LAST)
+        {
+            _toLast[idx] = 1.0 / resistance;
+        }
+        _diagonal[idx] = sum + _toFirst[idx] + _toLast[idx];
+    }
 }
 
-std::unordered_map<action2D, std::unique_ptr<MCTSNode>> *MCTSNode::getChildren()
+void ResistanceEvaluator::multiply(const std::array<double, BOARD_CELLS> &x, std::array<double, BOARD_CELLS> &y)
 {
-    return &_children;
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
+    {
+        double sum = _diagonal[idx] * x[idx];
+        for (int dir = 0; dir < 6; dir++)
+        {
+            sum -= _link[idx][dir] * x[TOPOLOGY[idx].ring[dir]];
+        }
+        y[idx] = sum;
+    }
 }
 
-std::unordered_map<action2D, std::unique_ptr<MCTSNode>>::iterator MCTSNode::select(float xplorCoeff, bool isPlayout)
+void ResistanceEvaluator::solve(std::array<double, BOARD_CELLS> &voltage)
 {
-    if (_children.size() == 0)
-    {
-        return _children.end();
-    }
-    if (isPlayout)
+    // Jacobi preconditioned conjugate gradient on L v = b, b the current fed by the first edge
+    std::array<double, BOARD_CELLS> residual, direction, product, preconditioned;
+    multiply(voltage, product);
+    double target = 0, rz = 0, norm = 0;
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
     {
-        return std::max_element(_children.begin(), _children.end(), [&xplorCoeff](const std::pair<const action2D, std::unique_ptr<MCTSNode>> &a, const std::pair<const action2D, std::unique_ptr<MCTSNode>> &b)
-                                { return a.second.get()->evaluation(xplorCoeff) < b.second.get()->evaluation(xplorCoeff); });
+        residual[idx] = _toFirst[idx] - product[idx];
+        preconditioned[idx] = residual[idx] / _diagonal[idx];
+        direction[idx] = preconditioned[idx];
+        target += _toFirst[idx] * _toFirst[idx];
+        rz += residual[idx] * preconditioned[idx];
+        norm += residual[idx] * residual[idx];
     }
-    else
+    const double tolerance = 1e-8 * target;
+    for (_iterations = 0; _iterations < BOARD_CELLS && norm > tolerance; _iterations++)
     {
-        return std::max_element(_children.begin(), _children.end(), [&xplorCoeff](const std::pair<const action2D, std::unique_ptr<MCTSNode>> &a, const std::pair<const action2D, std::unique_ptr<MCTSNode>> &b)
-                                { return a.second.get()->_nVisits < b.second.get()->_nVisits; });
+        multiply(direction, product);
+        double curvature = 0;
+        for (int idx = 0; idx < BOARD_CELLS; idx++)
+        {
+            curvature += direction[idx] * product[idx];
+        }
+        double alpha = rz / curvature;
+        double nextRz = 0;
+        norm = 0;
+        for (int idx = 0; idx < BOARD_CELLS; idx++)
+        {
+            voltage[idx] += alpha * direction[idx];
+            residual[idx] -= alpha * product[idx];
+            preconditioned[idx] = residual[idx] / _diagonal[idx];
+            nextRz += residual[idx] * preconditioned[idx];
+            norm += residual[idx] * residual[idx];
+        }
+        double beta = nextRz / rz;
+        rz = nextRz;
+        for (int idx = 0; idx < BOARD_CELLS; idx++)
+        {
+            direction[idx] = preconditioned[idx] + beta * direction[idx];
+        }
     }
 }
 
-void MCTSNode::update(float result)
-{
-    _nVisits += 1;
-    _quality += (result - _quality) / _nVisits;
-}
-
-void MCTSNode::update_from_root(float result)
+double ResistanceEvaluator::cellFlow(const std::array<double, BOARD_CELLS> &voltage, std::array<double, BOARD_CELLS> &flow)
 {
-    if (_parent != nullptr)
+    double total = 0;
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
     {
-        _parent->update_from_root(-result * 0.95);
+        total += _toFirst[idx] * (1 - voltage[idx]);
     }
-    update(result);
+    for (int idx = 0; idx < BOARD_CELLS; idx++)
+    {
+        // current entering a cell equals the current leaving it, half of both
+        double through = _toFirst[idx] * fabs(1 - voltage[idx]) + _toLast[idx] * fabs(voltage[idx]);
+        for (int dir = 0; dir < 6; dir++)
+        {
+            through += _link[idx][dir] * fabs(voltage[idx] - voltage[TOPOLOGY[idx].ring[dir]]);
+        }
+        flow[idx] = total > 0 ? through / 2 / total : 0;
+    }
+    return total;
 }
 
-bool MCTSNode::isRed()
+double ResistanceEvaluator::conductance(GameState &state, bool isRed)
 {
-    return _isRed;
+    std::array<double, BOARD_CELLS> &voltage = _voltage[isRed ? 0 : 1];
+    std::array<double, BOARD_CELLS> flow;
+    buildCircuit(state, isRed);
+    solve(voltage);
+    return cellFlow(voltage, flow);
 }
 
-void MCTSNode::expose()
+void ResistanceEvaluator::priors(GameState &state, MoveBuffer &moves)
 {
-    printf("Visit count: %d, qualiity: %f, uct: %f\n", _nVisits, _quality, _uct);
+    std::array<double, BOARD_CELLS> flow[2];
+    for (int side = 0; side < 2; side++)
+    {
+        buildCircuit(state, side == 0);
+        solve(_voltage[side]);
+        cellFlow(_voltage[side], flow[side]);
+    }
+    double busiest = 0;
+    for (auto &move : moves)
+    {
+        int idx = move.cell.value;
+        busiest = std::max(busiest, flow[0][idx] + flow[1][idx]);
+    }
+    for (auto &move : moves)
+    {
+        int idx = move.cell.value;
+        move.probability = busiest > 0 ? 1 + 5 * (flow[0][idx] + flow[1][idx]) / busiest : 1;
+    }
 }
 
-void MCTSNode::setParentNull()
+int ResistanceEvaluator::getIterations()
 {
-    _parent = nullptr;
+    return _iterations;
 }
 
-bool MCTSNode::isLeaf()
+ReplyTable::ReplyTable() : _afterTwo(2 * BOARD_CELLS * BOARD_CELLS, NO_MOVE), _afterOne(2 * BOARD_CELLS, NO_MOVE) {}
+
+int ReplyTable::reply(GameState &state)
 {
-    return _children.size() == 0;
+    int last = state.moveAt(state.getTotalPieces() - 1);
+    if (last < 0)
+    {
+        return -1;
+    }
+    int color = state.redPlaysNext() ? 0 : 1;
+    int beforeLast = state.moveAt(state.getTotalPieces() - 2);
+    Bitboard empty = state.emptyCells();
+    if (beforeLast >= 0)
+    {
+        int cell = _afterTwo[(color * BOARD_CELLS + beforeLast) * BOARD_CELLS + last];
+        if (cell != NO_MOVE && empty.test(cell))
+        {
+            return cell;
+        }
+    }
+    int cell = _afterOne[color * BOARD_CELLS + last];
+    return cell != NO_MOVE && empty.test(cell) ? cell : -1;
 }
 
-bool MCTSNode::isRoot()
+void ReplyTable::update(GameState &state, int fromPly, int winner)
 {
-    return _parent == nullptr;
+    for (int ply = std::max(fromPly, 1); ply < state.getTotalPieces(); ply++)
+    {
+        int cell = state.moveAt(ply);
+        int last = state.moveAt(ply - 1);
+        if (cell < 0 || last < 0)
+        {
+            continue;
+        }
+        // red plays the even plies
+        int color = ply % 2;
+        bool won = (color == 0) == (winner == 1);
+        int beforeLast = state.moveAt(ply - 2);
+        cell_t &one = _afterOne[color * BOARD_CELLS + last];
+        if (won)
+        {
+            one = cell;
+        }
+        else if (one == cell)
+        {
+            one = NO_MOVE;
+        }
+        if (beforeLast >= 0)
+        {
+            cell_t &two = _afterTwo[(color * BOARD_CELLS + beforeLast) * BOARD_CELLS + last];
+            if (won)
+            {
+                two = cell;
+            }
+            else if (two == cell)
+            {
+                two = NO_MOVE;
+            }
+        }
+    }
 }
 
-MCTS::MCTS(float explorationCoeff, time_t timeLimit)
-    : _root(new MCTSNode(nullptr, 1.0, false)), _xplorCoeff(explorationCoeff), _timeLimit(timeLimit), _state(GameState()), _rolloutCounter(0){};
+template <class Selection, class Rollout, class Prior, class Backup>
+MCTSEngine<Selection, Rollout, Prior, Backup>::MCTSEngine(float explorationCoeff, time_t timeLimit, int solverMinPieces, int rolloutCutoff, bool rootHalving)
+    : _root(new Node(nullptr, 1.0, false)), _xplorCoeff(explorationCoeff), _timeLimit(timeLimit), _state(GameState()), _rolloutCounter(0), _solver(), _solverMinPieces(solverMinPieces), _timeManager(timeLimit, timeLimit * 2), _watchdog(), _connections{VCEngine(true), VCEngine(false)}, _replies(), _rolloutCutoff(rolloutCutoff), _resistance(), _random(0x9E3779B97F4A7C15ULL), _rootHalving(rootHalving) {};
 
-GameState MCTS::getState()
+template <class Selection, class Rollout, class Prior, class Backup>
+GameState MCTSEngine<Selection, Rollout, Prior, Backup>::getState()
 {
     return _state;
 }
 
-void MCTS::setState(GameState state)
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::setState(GameState state)
 {
     _state = state;
+    _connections[0].reset(_state);
+    _connections[1].reset(_state);
     // need to update node red/black indicator accordingly
-    _root = std::make_unique<MCTSNode>(MCTSNode(nullptr, 1.0, _state.redPlayedLast()));
+    _root = std::make_unique<Node>(Node(nullptr, 1.0, _state.redPlayedLast()));
 }
 
-MCTSNode *MCTS::getRoot()
+template <class Selection, class Rollout, class Prior, class Backup>
+typename MCTSEngine<Selection, Rollout, Prior, Backup>::Node *MCTSEngine<Selection, Rollout, Prior, Backup>::getRoot()
 {
     return _root.get();
 }
 
-void MCTS::setRoot(MCTSNode *root)
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::setRoot(Node *root)
 {
-    _root = std::unique_ptr<MCTSNode>(root);
+    _root = std::unique_ptr<Node>(root);
 }
 
-void MCTS::gameStateRecover()
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::gameStateRecover()
 {
     _state.recoverState();
 }
 
-void MCTS::playout(GameState state_copy)
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::playout(GameState state_copy, Node *start)
 {
-    auto node = _root.get();
+    auto node = start == nullptr ? _root.get() : start;
+    // GRAVE reference nodes, for even and odd depth
+    Node *reference[2] = {start == nullptr || Selection::GRAVE_THRESHOLD == 0 ? nullptr : _root.get(), nullptr};
+    int depth = start == nullptr ? 0 : 1;
     while (true)
     {
         // printf("a1\n");
+        if (_watchdog.fired())
+        {
+            return;
+        }
         if (node->isLeaf())
         {
             break;
         }
-        auto it = node->select(_xplorCoeff);
+        if (Selection::GRAVE_THRESHOLD > 0 && (node->getVisits() >= Selection::GRAVE_THRESHOLD || reference[depth % 2] == nullptr))
+        {
+            reference[depth % 2] = node;
+        }
+        auto it = node->select(_xplorCoeff, true, reference[depth % 2]);
+        depth++;
         if (it == node->getChildren()->end())
         {
             printf("Error during playout select!");
@@ -903,41 +5051,113 @@ void MCTS::playout(GameState state_copy)
             state_copy.plays(it->first);
             node = it->second.get();
         }
+        // proven by the solver, back up the exact result instead of a rollout
+        if (node->getProof() != 0)
+        {
+            _rolloutCounter++;
+            node->update_from_root(node->getProof() * 16);
+            return;
+        }
     }
     // printf("a2\n");
-    std::vector<ActionPrior> apList = state_copy.outputActionPrior();
-    // std::vector<ActionPrior> apList;
-    // apList.push_back({{9, 5}, 1.0});
-    node->expand(apList);
-    branchingRollout(node, state_copy, 0);
+    MoveBuffer moves;
+    expansionPriors(state_copy, moves);
+    node->expand(moves);
+    // only the rollout of the policy is instantiated, it alone has the reward constants
+    if constexpr (Rollout::BATCH > 0)
+    {
+        // leaf parallel, the whole batch is backed up through the new leaf
+        int redWins = randomRollouts(state_copy, Rollout::BATCH, _random);
+        for (int i = 0; i < Rollout::BATCH; i++)
+        {
+            _rolloutCounter++;
+            node->update_from_root((i < redWins ? 1 : -1) * (node->isRed() ? 1 : -1));
+        }
+    }
+    else if constexpr (Rollout::BRANCHING)
+    {
+        branchingRollout(node, state_copy, 0);
+    }
+    else
+    {
+        singleRollout(node, state_copy, 0);
+    }
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::expansionPriors(GameState &state, MoveBuffer &moves)
+{
+    state.generateMoves(moves, true, {1, 2}, Prior::OPENING_RANGE);
+    Prior::apply(state, moves, _resistance);
+    Bitboard region;
+    if (!state.mustPlayRegion(region))
+    {
+        return;
+    }
+    // keep the candidates inside the region in place, in their order
+    int kept = 0;
+    for (int i = 0; i < moves.size(); i++)
+    {
+        int idx = moves[i].cell.value;
+        if (region.test(idx))
+        {
+            moves[kept++] = moves[i];
+            region.reset(idx);
+        }
+    }
+    moves.resize(kept);
+    // must-play cells left out by the opening range or as inferior cells
+    for (int idx = region.lowest(); idx >= 0; idx = region.lowest())
+    {
+        region.reset(idx);
+        moves.push_back({{(cell_t)idx}, 1.0});
+    }
 }
 
-void MCTS::singleRollout(MCTSNode *startNode, GameState state, int counter)
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::singleRollout(Node *startNode, GameState state, int counter)
 {
     while (!state.boardIsFull())
     {
-        if (counter <= 8)
+        if (_watchdog.fired())
         {
-            float end = state.checkTermination();
-            if (end != 0)
-            {
-                _rolloutCounter++;
-                startNode->update_from_root(end * 10 / (counter + 1) * (startNode->isRed() ? 1 : -1));
-                return;
-            }
+            return;
         }
-        std::vector<ActionPrior> action_prior = state.outputActionPrior();
-        auto it = std::max_element(action_prior.begin(), action_prior.end(), [](const ActionPrior &ap1, const ActionPrior &ap2)
-                                   { return ap1.probability < ap2.probability; });
-        action2D action = it->action;
-        state.plays(action);
+        // termination is kept by the groups, checking it every move is free
+        float end = state.checkTermination();
+        if (end != 0)
+        {
+            _rolloutCounter++;
+            _replies.update(state, _state.getTotalPieces(), end);
+            startNode->update_from_root(end * (counter <= Rollout::QUICK_WIN_PLIES ? (double)Rollout::QUICK_WIN_REWARD / (counter + 1) : 1.0) * (startNode->isRed() ? 1 : -1), &state);
+            return;
+        }
+        // cut long rollouts, the static evaluation stands for the rest of the game
+        if (_rolloutCutoff > 0 && counter >= _rolloutCutoff)
+        {
+            _rolloutCounter++;
+            startNode->update_from_root(state.evaluate() * (startNode->isRed() ? 1 : -1), &state);
+            return;
+        }
+        // dead and captured cells do not change the winner, fill them instead of playing them out
+        state.fillInferiorCells();
+        if (state.boardIsFull())
+        {
+            break;
+        }
+        // a winning cell is played at once, an opponent's winning cell is blocked
+        int forced = state.forcedCell();
+        // else the last good reply to the previous moves
+        forced = forced >= 0 ? forced : _replies.reply(state);
+        state.plays(forced >= 0 ? action2D{forced / BOARD_SIZE, forced % BOARD_SIZE} : state.rolloutAction());
         counter++;
     }
     int end = state.checkTermination();
     if (end != 0)
     {
         _rolloutCounter++;
-        startNode->update_from_root(end * (startNode->isRed() ? 1 : -1));
+        _replies.update(state, _state.getTotalPieces(), end);
+        startNode->update_from_root(end * (startNode->isRed() ? 1 : -1), &state);
         return;
     }
     else
@@ -946,12 +5166,20 @@ void MCTS::singleRollout(MCTSNode *startNode, GameState state, int counter)
     }
 }
 
-int MCTS::getRolloutCounter()
+template <class Selection, class Rollout, class Prior, class Backup>
+int MCTSEngine<Selection, Rollout, Prior, Backup>::getRolloutCounter()
 {
     return _rolloutCounter;
 }
 
-MCTSNode *MCTS::getNodeForAction(action2D action)
+template <class Selection, class Rollout, class Prior, class Backup>
+time_t MCTSEngine<Selection, Rollout, Prior, Backup>::getTimeBank()
+{
+    return _timeManager.getTimeBank();
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+typename MCTSEngine<Selection, Rollout, Prior, Backup>::Node *MCTSEngine<Selection, Rollout, Prior, Backup>::getNodeForAction(action2D action)
 {
     auto it = _root->getChildren()->find(action);
     if (it != _root->getChildren()->end())
@@ -961,102 +5189,212 @@ MCTSNode *MCTS::getNodeForAction(action2D action)
     return nullptr;
 }
 
-void MCTS::branchingRollout(MCTSNode *startNode, GameState state, int counter, int search_indicator)
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::branchingRollout(Node *startNode, GameState state, int counter, int search_indicator)
 {
     // 32 diviser for branching
     int diviser = 31;
-    // 16 diviser for termination check
-    int termDiv = 15;
-    while (!state.boardIsFull())
+    // branches put aside at a branch point, each resumes once its split branch has ended
+    int pending = 0;
+    while (true)
     {
-        // printf("a1\n");
-        // check for termination for first 5 rounds
-        // for 10 immediate step, the closer to startNode, the higher the reward
-        if (counter <= 10)
+        bool ended = false;
+        while (!state.boardIsFull())
         {
-            float end = state.checkTermination();
-            if (end != 0)
+            // abandon the rollout without backup, the watchdog needs the tree as it is
+            if (_watchdog.fired())
             {
-                startNode->update_from_root(end * 16 / (counter + 1) * (startNode->isRed() ? 1 : -1));
                 return;
             }
-        }
+            // for QUICK_WIN_PLIES immediate steps, the closer to startNode, the higher the reward
+            if (counter <= Rollout::QUICK_WIN_PLIES)
+            {
+                float end = state.checkTermination();
+                if (end != 0)
+                {
+                    _replies.update(state, _state.getTotalPieces(), end);
+                    startNode->update_from_root(end * Rollout::QUICK_WIN_REWARD / (counter + 1) * (startNode->isRed() ? 1 : -1), &state);
+                    ended = true;
+                    break;
+                }
+            }
+
+            // termination is kept by the groups, checking it every move is free
+            if (counter > Rollout::QUICK_WIN_PLIES)
+            {
+                float end = state.checkTermination();
+                if (end != 0)
+                {
+                    _rolloutCounter++;
+
+                    _replies.update(state, _state.getTotalPieces(), end);
+                    startNode->update_from_root(end * (startNode->isRed() ? 1 : -1) * pow(Backup::MOVE_DISCOUNT, counter), &state);
+                    ended = true;
+                    break;
+                }
+            }
+            // cut long rollouts, the static evaluation stands for the rest of the game
+            if (_rolloutCutoff > 0 && counter >= _rolloutCutoff)
+            {
+                _rolloutCounter++;
+                startNode->update_from_root(state.evaluate() * (startNode->isRed() ? 1 : -1) * pow(Backup::MOVE_DISCOUNT, counter), &state);
+                ended = true;
+                break;
+            }
+
+            // branching, unless the move is forced and both branches would play it:
+            // this branch goes on as 1 once the split branch 2 from the same state has ended
+            if (search_indicator == 0 && (counter & diviser) == 0 && state.forcedCell() < 0 && pending < ROLLOUT_BRANCHES)
+            {
+                _pendingBranches[pending++] = {state, counter};
+                search_indicator = 2;
+            }
 
-        if ((counter & termDiv) == 0 && counter != 0)
+            // dead and captured cells do not change the winner, fill them instead of playing them out
+            state.fillInferiorCells();
+            if (state.boardIsFull())
+            {
+                break;
+            }
+            // a winning cell is played at once, an opponent's winning cell is blocked,
+            // else 1 and 2: the two branches take the best move of either half of the action space
+            int forced = state.forcedCell();
+            // else the last good reply to the previous moves, the second branch goes without
+            forced = forced >= 0 || search_indicator == 2 ? forced : _replies.reply(state);
+            state.plays(forced >= 0 ? action2D{forced / BOARD_SIZE, forced % BOARD_SIZE} : state.rolloutAction(search_indicator));
+            counter++;
+            search_indicator = 0;
+        }
+        if (!ended)
         {
-            float end = state.checkTermination();
+            int end = state.checkTermination();
             if (end != 0)
             {
                 _rolloutCounter++;
-
-                startNode->update_from_root(end * (startNode->isRed() ? 1 : -1) * pow(0.995, counter));
-                return;
+                _replies.update(state, _state.getTotalPieces(), end);
+                startNode->update_from_root(end * (startNode->isRed() ? 1 : -1) * pow(Backup::MOVE_DISCOUNT, counter), &state);
+            }
+            else
+            {
+                printf("Error at the end of branchingRollout!\n");
             }
         }
-
-        // branching
-        if (search_indicator == 0 && (counter & diviser) == 0)
+        if (pending == 0)
         {
+            return;
+        }
+        pending--;
+        state = _pendingBranches[pending].state;
+        counter = _pendingBranches[pending].counter;
+        search_indicator = 1;
+    }
+}
 
-            search_indicator = 1;
-            GameState stateCopy = state;
-            branchingRollout(startNode, stateCopy, counter, 2);
+template <class Selection, class Rollout, class Prior, class Backup>
+action2D MCTSEngine<Selection, Rollout, Prior, Backup>::getNextMove(time_t startTime, float timeMultiplier)
+{
+    _timeManager.startTurn(startTime, timeMultiplier);
+    if (_root->isLeaf())
+    {
+        MoveBuffer moves;
+        expansionPriors(_state, moves);
+        _root->expand(moves);
+    }
+    _timeManager.plan(_state.getTotalPieces(), _root->getChildren()->size());
+    _watchdog.arm(_timeManager.emergencyDeadline(), fallbackMove());
+    // a twentieth of the turn for virtual connections, cut searches resume next turn
+    action2D winning;
+    if (connectionMove(searchClock().now() + _timeManager.remaining(false) / 20.0, winning))
+    {
+        _timeManager.endTurn();
+        action2D emitted;
+        return _watchdog.disarm(emitted) ? emitted : winning;
+    }
+    if (!_root->isLeaf())
+    {
+        _watchdog.setBestSoFar(_root->select(_xplorCoeff, false)->first);
+    }
+    Bitboard lostCarrier;
+    // a side already virtually connected has won, nothing left for the solver to prove
+    bool useSolver = _state.getTotalPieces() >= _solverMinPieces && !_connections[_state.redPlaysNext() ? 1 : 0].connected(lostCarrier);
+    if (useSolver)
+    {
+        _solver.start(_state, _timeManager.hardDeadline());
+    }
+    time_t searchStart = _timeManager.elapsed();
+    int playouts = 0;
+    // first batch is small, later batches are sized from the measured playout rate
+    int batch = 4;
+    bool critical = false;
+    action2D lastBest = {-1, -1};
+    int lastChange = 0;
+    action2D halved = _rootHalving ? halvingMove() : action2D{-1, -1};
+    while (!_rootHalving && !_solver.solved() && !_watchdog.fired())
+    {
+        double batchStart = searchClock().now();
+        for (int i = 0; i < batch; i++)
+        {
+            auto stateCopy = _state;
+            playout(stateCopy);
         }
+        playouts += batch;
+        batch = _timeManager.nextBatch((searchClock().now() - batchStart) / batch);
+        time_t searchTime = std::max((time_t)1, _timeManager.elapsed() - searchStart);
 
-        std::vector<ActionPrior> action_prior = state.outputActionPrior();
-        action2D action;
-        int mid = action_prior.size() / 2;
-        if (search_indicator == 0)
+        // critical: best move changed in the last fifth of the search, or the runner-up is close behind
+        auto bestIt = _root->select(_xplorCoeff, false);
+        if (bestIt == _root->getChildren()->end())
+        {
+            break;
+        }
+        if (!(bestIt->first == lastBest))
         {
-            auto it = std::max_element(action_prior.begin(), action_prior.end(), [](const ActionPrior &ap1, const ActionPrior &ap2)
-                                       { return ap1.probability < ap2.probability; });
-            action = it->action;
+            lastChange = playouts;
+            lastBest = bestIt->first;
+            _watchdog.setBestSoFar(lastBest);
         }
-        else if (search_indicator == 1 && action_prior.size() > 1)
+        // a proven win is played whatever the visits
+        if (bestIt->second->getProof() > 0)
         {
-            // first half of action space
-            auto it = std::max_element(action_prior.begin(), action_prior.begin() + mid, [](const ActionPrior &ap1, const ActionPrior &ap2)
-                                       { return ap1.probability < ap2.probability; });
-            action = it->action;
+            break;
         }
-        else
+        int bestVisits, secondVisits;
+        _root->topTwoVisits(bestVisits, secondVisits);
+        critical = lastChange * 5 > playouts * 4 || secondVisits * 10 > bestVisits * 7;
+        if (_timeManager.shouldStop(critical))
         {
-            // second half of action space
-            auto it = std::max_element(action_prior.begin() + mid, action_prior.end(), [](const ActionPrior &ap1, const ActionPrior &ap2)
-                                       { return ap1.probability < ap2.probability; });
-            action = it->action;
+            break;
         }
 
-        state.plays(action);
-        counter++;
-        search_indicator = 0;
+        // estimate playouts left from the measured rate, stop if runner-up cannot catch up
+        long remaining = (long)playouts * _timeManager.remaining(critical) / searchTime;
+        if (bestVisits - secondVisits > remaining)
+        {
+            break;
+        }
     }
-    int end = state.checkTermination();
-    if (end != 0)
+    _timeManager.endTurn();
+    if (useSolver)
     {
-        _rolloutCounter++;
-        startNode->update_from_root(end * (startNode->isRed() ? 1 : -1) * pow(0.995, counter));
-        return;
+        _solver.stop();
     }
-    else
+    action2D emitted;
+    if (_watchdog.disarm(emitted))
     {
-        printf("Error at the end of branchingRollout!\n");
+        // the watchdog already answered the judge, the answer stands
+        return emitted;
     }
-}
-
-action2D MCTS::getNextMove(time_t startTime, float timeMultiplier)
-{
-    float timeLim = _timeLimit * timeMultiplier;
-    time_t time_passes = 0;
-    while (((1.0 * time_passes / timeLim) * 100) < 87)
+    if (useSolver)
     {
-        for (int i = 0; i < 50; i++)
+        importProofs(_root.get(), _state, 2);
+        if (_solver.solved())
         {
-            auto stateCopy = _state;
-            playout(stateCopy);
+            return _solver.getBestMove();
         }
-
-        time_passes = getTimeInMilis() - startTime;
+    }
+    if (halved.actionX >= 0)
+    {
+        return halved;
     }
     auto it = _root->select(_xplorCoeff, false);
     if (it == _root->getChildren()->end())
@@ -1070,8 +5408,148 @@ action2D MCTS::getNextMove(time_t startTime, float timeMultiplier)
     }
 }
 
-void MCTS::updateWithMove(action2D action)
+template <class Selection, class Rollout, class Prior, class Backup>
+action2D MCTSEngine<Selection, Rollout, Prior, Backup>::fallbackMove()
+{
+    action2D fallback = {-1, -1};
+    float bestPrior = -1;
+    for (auto &child : *_root->getChildren())
+    {
+        if (child.second->getProof() >= 0 && child.second->getPrior() > bestPrior)
+        {
+            bestPrior = child.second->getPrior();
+            fallback = child.first;
+        }
+    }
+    if (fallback.actionX < 0)
+    {
+        int cell = _state.emptyCells().lowest();
+        fallback = {cell / BOARD_SIZE, cell % BOARD_SIZE};
+    }
+    return fallback;
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+action2D MCTSEngine<Selection, Rollout, Prior, Backup>::halvingMove()
+{
+    auto children = _root->getChildren();
+    std::vector<action2D> candidates;
+    for (auto &child : *children)
+    {
+        // children proven lost are never candidates
+        if (child.second->getProof() >= 0)
+        {
+            candidates.push_back(child.first);
+        }
+    }
+    // quality of a child is from the view of the player to move at the root
+    auto byQuality = [&](const action2D &a, const action2D &b)
+    { return children->at(a)->getQuality() > children->at(b)->getQuality(); };
+
+    int roundsLeft = std::max(1, (int)ceil(log2(std::max((size_t)1, candidates.size()))));
+    // playout rate refined after every round
+    time_t searchStart = _timeManager.elapsed();
+    long playouts = 0;
+    bool outOfTime = false;
+    while (candidates.size() > 1 && !outOfTime)
+    {
+        double rate = (playouts + 1.0) / std::max((time_t)1, _timeManager.elapsed() - searchStart);
+        int perCandidate = std::max(1, (int)(rate * _timeManager.remaining(false) / roundsLeft / candidates.size()));
+        for (auto &action : candidates)
+        {
+            Node *child = children->at(action).get();
+            for (int i = 0; i < perCandidate; i++)
+            {
+                auto stateCopy = _state;
+                stateCopy.plays(action);
+                playout(stateCopy, child);
+            }
+            playouts += perCandidate;
+            if (_solver.solved() || _watchdog.fired() || _timeManager.shouldStop(false))
+            {
+                outOfTime = true;
+                break;
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), byQuality);
+        candidates.resize((candidates.size() + 1) / 2);
+        roundsLeft = std::max(1, roundsLeft - 1);
+        _watchdog.setBestSoFar(candidates[0]);
+    }
+    return candidates.empty() ? action2D{-1, -1} : candidates[0];
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+bool MCTSEngine<Selection, Rollout, Prior, Backup>::connectionMove(double deadline, action2D &action)
+{
+    bool isRed = _state.redPlaysNext();
+    VCEngine &mine = _connections[isRed ? 0 : 1];
+    VCEngine &theirs = _connections[isRed ? 1 : 0];
+    double now = searchClock().now();
+    mine.search(now + (deadline - now) / 2);
+    theirs.search(deadline);
+
+    // a semi connection between the edges wins by its key, a full one by any carrier cell
+    Bitboard carrier;
+    int cell = mine.winningKeys().lowest();
+    if (cell < 0 && mine.connected(carrier))
+    {
+        cell = carrier.lowest();
+    }
+    if (cell >= 0)
+    {
+        action = {cell / BOARD_SIZE, cell % BOARD_SIZE};
+        return true;
+    }
+
+    // every move leaving one of the opponent's semi connections intact loses
+    Bitboard region;
+    if (theirs.connected(carrier) || !theirs.threats(region))
+    {
+        return false;
+    }
+    auto children = _root->getChildren();
+    bool anyInside = std::any_of(children->begin(), children->end(), [&](const std::pair<const action2D, std::unique_ptr<Node>> &child)
+                                 { return region.test(child.first.actionX * BOARD_SIZE + child.first.actionY); });
+    if (!anyInside)
+    {
+        return false;
+    }
+    for (auto &child : *children)
+    {
+        if (!region.test(child.first.actionX * BOARD_SIZE + child.first.actionY))
+        {
+            child.second->setProof(-1);
+        }
+    }
+    return false;
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::search(int playouts)
+{
+    for (int i = 0; i < playouts; i++)
+    {
+        auto stateCopy = _state;
+        playout(stateCopy);
+    }
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::skipSearch(time_t startTime, action2D action)
 {
+    _timeManager.startTurn(startTime);
+    _timeManager.plan(_state.getTotalPieces(), 2);
+    _watchdog.arm(_timeManager.emergencyDeadline(), action);
+    _timeManager.endTurn();
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::updateWithMove(action2D action)
+{
+    bool isRed = _state.redPlaysNext();
+    _connections[0].play(action.actionX * BOARD_SIZE + action.actionY, isRed);
+    _connections[1].play(action.actionX * BOARD_SIZE + action.actionY, isRed);
     auto rootChildren = _root->getChildren();
     auto it = rootChildren->find(action);
     if (it != rootChildren->end())
@@ -1083,10 +5561,46 @@ void MCTS::updateWithMove(action2D action)
     else
     {
         _state.plays(action);
-        _root = std::make_unique<MCTSNode>(MCTSNode(nullptr, 1.0, _state.redPlayedLast()));
+        _root = std::make_unique<Node>(Node(nullptr, 1.0, _state.redPlayedLast()));
     }
     // _state.plays(action);
-    // _root = std::make_unique<MCTSNode>(MCTSNode(nullptr, 1.0, _state.redPlayedLast()));
+    // _root = std::make_unique<Node>(Node(nullptr, 1.0, _state.redPlayedLast()));
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::setResponder(std::function<void(action2D)> emit)
+{
+    _watchdog.setEmitter(emit);
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::respond(action2D action)
+{
+    _watchdog.respond(action);
+}
+
+template <class Selection, class Rollout, class Prior, class Backup>
+void MCTSEngine<Selection, Rollout, Prior, Backup>::importProofs(Node *node, GameState state, int depth)
+{
+    if (depth == 0)
+    {
+        return;
+    }
+    for (auto &child : *node->getChildren())
+    {
+        GameState childState = state;
+        childState.plays(child.first);
+        // solver result is for the player to move, the node belongs to the player who moved
+        int result = _solver.lookup(childState);
+        if (result != 0)
+        {
+            child.second->setProof(-result);
+        }
+        else
+        {
+            importProofs(child.second.get(), childState, depth - 1);
+        }
+    }
 }
 // int main()
 // {
@@ -1096,6 +5610,8 @@ void MCTS::updateWithMove(action2D action)
 //     std::cout << mcts.getRolloutCounter();
 // }
 
+// tools built from this file, like BookBuilder.cpp, define HEXMCTS_NO_MAIN
+#ifndef HEXMCTS_NO_MAIN
 int main()
 {
 
@@ -1105,18 +5621,36 @@ int main()
     g.recoverState();
     MCTS mcts;
     mcts.setState(g);
-    action2D action = mcts.getNextMove(startTime, 1.9);
-    mcts.updateWithMove(action);
+    OpeningBook book;
+    book.open("data/hexbook.bin");
 
     Json::Value ret;
-    ret["response"] = act2act(action);
     Json::FastWriter writer;
     Json::Reader reader;
     Json::Value input;
     std::string str;
-    std::cout << writer.write(ret) << std::endl;
-    std::cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << std::endl;
-    fflush(stdout);
+    // called by the main thread, or by the watchdog when the search runs out of time
+    mcts.setResponder([&](action2D action)
+                      {
+                          ret["response"] = act2act(action);
+                          std::cout << writer.write(ret) << std::endl;
+                          std::cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << std::endl;
+                          fflush(stdout); });
+    // book moves are answered at once, their budget goes to the middle game
+    auto think = [&]()
+    {
+        GameState current = mcts.getState();
+        action2D move;
+        if (book.probe(current, move))
+        {
+            mcts.skipSearch(startTime, move);
+            return move;
+        }
+        return mcts.getNextMove(startTime);
+    };
+    action2D action = think();
+    mcts.respond(action);
+    mcts.updateWithMove(action);
     while (true)
     {
 
@@ -1125,11 +5659,9 @@ int main()
         reader.parse(str, input);
         action = {input["x"].asInt(), input["y"].asInt()};
         mcts.updateWithMove(action);
-        action = mcts.getNextMove(startTime);
+        action = think();
+        mcts.respond(action);
         mcts.updateWithMove(action);
-        ret["response"] = act2act(action);
-        std::cout << writer.write(ret) << std::endl;
-        std::cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << std::endl;
-        fflush(stdout);
     }
 };
+#endif